@@ -0,0 +1,178 @@
+/* hosted.c - MemTest-86  Version 3.3
+ *
+ * Runs the tests of smptest.c as an ordinary Linux program, over a
+ * large anonymous mapping, first on one CPU and then on several, and
+ * shows how the throughput scales.  Build it with "make memtest-bench"
+ * and run it as
+ *
+ *	memtest-bench [megabytes [cpus]]
+ *
+ * The defaults are 1024 megabytes and every online CPU.  The address
+ * test and the bit fade test are left out: the first only ever runs on
+ * one CPU, and the second is mostly sleeping.
+ *
+ * Released under version 2 of the Gnu Public License.
+ */
+#include "test.h"
+#include <stdio.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/sysinfo.h>
+
+struct vars variables;
+struct vars * const v = &variables;
+
+struct tseq tseq[] = {
+	{1, 0, 1, 1, 0, "[Hosted benchmark]"},
+};
+int segs, bail;
+int test_ticks, nticks;
+
+/* There is no screen, keyboard or memory controller to look at */
+void cprint(int y, int x, const char *s) { }
+void dprint(int y, int x, ulong val, int len, int right) { }
+void hprint(int y, int x, ulong val) { }
+void hprint2(int y, int x, ulong val, int len) { }
+void set_ega_color(int y, int x, char color) { }
+void scroll(void) { }
+void check_input(void) { }
+void poll_errors(void) { }
+
+unsigned long page_of(void *adr)
+{
+	return ((unsigned long)adr >> 12);
+}
+
+void sleep(int n)
+{
+	struct timespec ts;
+
+	ts.tv_sec = n;
+	ts.tv_nsec = 0;
+	nanosleep(&ts, NULL);
+}
+
+static void own_address(struct tpart *tp)
+{
+	addr_tst2(tp);
+}
+
+static void ones_zeros(struct tpart *tp)
+{
+	movinv1(tp, 1, 0, ~0UL);
+}
+
+static void shifting(struct tpart *tp)
+{
+	movinv32(tp, 1, 1, 1, 0x80000000, 0, 0);
+}
+
+static void random_seq(struct tpart *tp)
+{
+	movinvr(tp);
+}
+
+static void moves(struct tpart *tp)
+{
+	block_move(tp, 4);
+}
+
+static void modulo(struct tpart *tp)
+{
+	modtst(tp, 0, 1, 0x55555555, 0xaaaaaaaa);
+}
+
+static const struct {
+	char *name;
+	void (*fn)(struct tpart *tp);
+} kernels[] = {
+	{ "Address test, own address", own_address },
+	{ "Moving inversions, ones & zeros", ones_zeros },
+	{ "Moving inversions, 32 bit pattern", shifting },
+	{ "Random number sequence", random_seq },
+	{ "Block move, 4 moves", moves },
+	{ "Modulo 20, one offset", modulo },
+};
+#define NKERNELS	(sizeof(kernels) / sizeof(kernels[0]))
+
+static double seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+/*
+ * Run one kernel over all of the mapping on n CPUs, and return the
+ * megabytes tested per second.
+ */
+static double run(int k, int n, ulong megs)
+{
+	double t;
+
+	ncpus = n;
+	smp_partition();
+	t = seconds();
+	smp_run(kernels[k].fn);
+	t = seconds() - t;
+	return (megs / t);
+}
+
+int main(int argc, char **argv)
+{
+	ulong megs = 1024, len;
+	int cpus = get_nprocs();
+	int k, n;
+	double base, rate;
+	void *mem;
+
+	if (argc > 1 && sscanf(argv[1], "%lu", &megs) != 1) {
+		fprintf(stderr, "usage: memtest-bench [megabytes [cpus]]\n");
+		return (1);
+	}
+	if (argc > 2 && sscanf(argv[2], "%d", &cpus) != 1) {
+		fprintf(stderr, "usage: memtest-bench [megabytes [cpus]]\n");
+		return (1);
+	}
+	if (cpus < 1) {
+		cpus = 1;
+	}
+	if (cpus > MAX_CPUS) {
+		cpus = MAX_CPUS;
+	}
+
+	len = megs << 20;
+	mem = mmap(NULL, len, PROT_READ|PROT_WRITE,
+		MAP_PRIVATE|MAP_ANONYMOUS|MAP_POPULATE, -1, 0);
+	if (mem == MAP_FAILED) {
+		perror("mmap");
+		return (1);
+	}
+	v->map[0].pbase_addr = (ulong)mem >> 12;
+	v->map[0].start = mem;
+	v->map[0].end = (ulong *)((char *)mem + len);
+	segs = 1;
+	test_ticks = 1;
+	v->pass_ticks = 1;
+
+	printf("%lu MB, 1 to %d CPUs, MB/s (speedup)\n", megs, cpus);
+	for (k = 0; k < NKERNELS; k++) {
+		printf("%-36s", kernels[k].name);
+		fflush(stdout);
+		base = run(k, 1, megs);
+		printf(" %7.0f", base);
+		for (n = 1; n < cpus; ) {
+			n = (2 * n < cpus) ? 2 * n : cpus;
+			rate = run(k, n, megs);
+			printf("  %d: %7.0f (%.1fx)", n, rate, rate / base);
+			fflush(stdout);
+		}
+		printf("\n");
+	}
+	if (v->ecount) {
+		printf("%d errors\n", v->ecount);
+		return (1);
+	}
+	return (0);
+}
@@ -4,6 +4,8 @@
 /******************************************************************/
 
 unsigned int rand( void );           /* returns a random 32-bit integer */
+unsigned int rand_next( unsigned int *, unsigned int * );  /* the same, with */
+                                     /* the caller's generator state      */
 void  rand_seed( unsigned int, unsigned int );      /* seed the generator */
 
 /* return a random float >= 0 and < 1 */
@@ -13,14 +15,20 @@ static unsigned int SEED_X = 521288629;
 static unsigned int SEED_Y = 362436069;
 
 
-unsigned int rand ()
+unsigned int rand_next ( unsigned int *seedx, unsigned int *seedy )
    {
-   static unsigned int a = 18000, b = 30903;
+   static const unsigned int a = 18000, b = 30903;
+
+   *seedx = a*(*seedx&65535) + (*seedx>>16);
+   *seedy = b*(*seedy&65535) + (*seedy>>16);
+
+   return ((*seedx<<16) + (*seedy&65535));
+   }
 
-   SEED_X = a*(SEED_X&65535) + (SEED_X>>16);
-   SEED_Y = b*(SEED_Y&65535) + (SEED_Y>>16);
 
-   return ((SEED_X<<16) + (SEED_Y&65535));
+unsigned int rand ()
+   {
+   return rand_next(&SEED_X, &SEED_Y);
    }
 
 
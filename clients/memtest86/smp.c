@@ -0,0 +1,160 @@
+/* smp.c - MemTest-86  Version 3.3
+ *
+ * Running the tests of smptest.c on several CPUs at once, for the
+ * hosted benchmark (hosted.c).  The segments to test are split into one
+ * part per CPU, and every CPU runs the same test over its own part on
+ * its own thread, meeting the others at barrier() between the phases
+ * of the test that must not overlap.
+ *
+ * Released under version 2 of the Gnu Public License.
+ */
+#include "test.h"
+#include <pthread.h>
+
+extern int segs, bail;
+extern int nticks;
+
+int ncpus = 1;
+struct tpart parts[MAX_CPUS];
+
+static volatile int bar_count;
+static volatile int bar_sense;
+static volatile int cpu_ticks;	/* ticks from the CPUs other than 0 */
+
+/*
+ * Divide the segments in v->map among the CPUs, so that each gets
+ * about the same number of pages.  Parts are split on page boundaries,
+ * which keeps every test's pattern alignment.
+ */
+void smp_partition(void)
+{
+	ulong total, share, left, len;
+	ulong *start;
+	struct tpart *tp;
+	struct mmap *m;
+	int i, j;
+
+	total = 0;
+	for (j = 0; j < segs; j++) {
+		total += ((ulong)v->map[j].end - (ulong)v->map[j].start) >> 12;
+	}
+	share = (total + ncpus - 1) / ncpus;
+
+	j = 0;
+	start = segs ? v->map[0].start : 0;
+	for (i = 0; i < ncpus; i++) {
+		tp = &parts[i];
+		tp->cpu = i;
+		tp->segs = 0;
+		if (tp->seedx == 0) {
+			tp->seedx = 521288629 + i;
+			tp->seedy = 362436069 - i;
+		}
+		/* The last CPU takes whatever is left */
+		left = (i == ncpus - 1) ? ~0UL : share;
+		while (j < segs && left) {
+			len = ((ulong)v->map[j].end - (ulong)start) >> 12;
+			m = &tp->map[tp->segs++];
+			m->pbase_addr = v->map[j].pbase_addr +
+				(((ulong)start - (ulong)v->map[j].start) >> 12);
+			m->start = start;
+			if (len <= left) {
+				m->end = v->map[j].end;
+				left -= len;
+				if (++j < segs) {
+					start = v->map[j].start;
+				}
+			} else {
+				start = (ulong *)((ulong)start + (left << 12));
+				m->end = start;
+				left = 0;
+			}
+		}
+	}
+}
+
+/*
+ * Wait until every CPU has reached this barrier, or until the test is
+ * abandoned.
+ */
+void barrier(struct tpart *tp)
+{
+	if (ncpus == 1) {
+		return;
+	}
+	tp->sense = !tp->sense;
+	if (__sync_add_and_fetch(&bar_count, 1) == ncpus) {
+		bar_count = 0;
+		__sync_synchronize();
+		bar_sense = tp->sense;
+	} else {
+		while (bar_sense != tp->sense && !*(volatile int *)&bail)
+			;
+	}
+}
+
+/*
+ * Count the end of a SPINSZ chunk.  CPU 0 owns the screen and the
+ * keyboard, so it does the do_tick() for all of them.
+ */
+void tick(struct tpart *tp)
+{
+	int n;
+
+	if (tp->cpu != 0) {
+		__sync_fetch_and_add(&cpu_ticks, 1);
+		return;
+	}
+	n = __sync_fetch_and_and(&cpu_ticks, 0);
+	nticks += n;
+	v->total_ticks += n;
+	do_tick();
+}
+
+static void smp_begin(void)
+{
+	int i;
+
+	bar_count = 0;
+	bar_sense = 0;
+	for (i = 0; i < ncpus; i++) {
+		parts[i].sense = 0;
+	}
+}
+
+static void smp_end(void)
+{
+	int n;
+
+	n = __sync_fetch_and_and(&cpu_ticks, 0);
+	nticks += n;
+	v->total_ticks += n;
+}
+
+static void (*smp_fn)(struct tpart *tp);
+
+static void *smp_thread(void *arg)
+{
+	smp_fn((struct tpart *)arg);
+	return NULL;
+}
+
+/*
+ * Run fn on every part at once, each on its own thread.
+ */
+void smp_run(void (*fn)(struct tpart *tp))
+{
+	pthread_t tid[MAX_CPUS];
+	int i;
+
+	smp_begin();
+	smp_fn = fn;
+	for (i = 1; i < ncpus; i++) {
+		pthread_create(&tid[i], NULL, smp_thread, &parts[i]);
+	}
+	fn(&parts[0]);
+	for (i = 1; i < ncpus; i++) {
+		pthread_join(tid[i], NULL);
+	}
+	smp_end();
+}
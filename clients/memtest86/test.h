@@ -109,16 +109,36 @@ void hprint2(int y,int x, ulong val, int len);
 void xprint(int y,int x,ulong val);
 void aprint(int y,int x,ulong page);
 void dprint(int y,int x,ulong val,int len, int right);
+#ifdef HOSTED
+/* The tests in smptest.c, each run over one CPU's part */
+struct tpart;
+void movinv1(struct tpart *tp, int iter, ulong p1, ulong p2);
+void movinvr(struct tpart *tp);
+void movinv32(struct tpart *tp, int iter, ulong p1, ulong lb, ulong mb,
+	int sval, int off);
+void modtst(struct tpart *tp, int off, int iter, ulong p1, ulong p2);
+void addr_tst1(struct tpart *tp);
+void addr_tst2(struct tpart *tp);
+void bit_fade(struct tpart *tp);
+void block_move(struct tpart *tp, int iter);
+void mv_error(ulong *adr, ulong good, ulong bad);
+#else
 void movinv1(int iter, ulong p1, ulong p2);
 void movinvr();
 void movinv32(int iter, ulong p1, ulong lb, ulong mb, int sval, int off);
 void modtst(int off, int iter, ulong p1, ulong p2);
+void addr_tst1(void);
+void addr_tst2(void);
+void bit_fade(void);
+void block_move(int iter);
+#endif
 void error(ulong* adr, ulong good, ulong bad);
 void ad_err1(ulong *adr1, ulong *adr2, ulong good, ulong bad);
 void ad_err2(ulong *adr, ulong bad);
 void do_tick(void);
 void rand_seed(int seed1, int seed2);
 ulong rand();
+unsigned int rand_next(unsigned int *seedx, unsigned int *seedy);
 void init(void);
 struct eregs;
 void inter(struct eregs *trap_regs);
@@ -132,11 +152,7 @@ void popclear(void);
 void get_config(void);
 void get_menu(void);
 void get_printmode(void);
-void addr_tst1(void);
-void addr_tst2(void);
-void bit_fade(void);
 void sleep(int sec);
-void block_move(int iter);
 void find_ticks(void);
 void print_err(ulong *adr, ulong good, ulong bad, ulong xor);
 void print_ecc_err(ulong page, ulong offset, int corrected, 
@@ -286,6 +302,43 @@ struct vars {
 	ulong reserved_pages;
 };
 
+#ifdef HOSTED
+/*
+ * The share of the memory under test that one CPU works on, from
+ * smp_partition().  The tests in smptest.c run on every CPU at once,
+ * each over its own part, with its own random number state.
+ */
+#define MAX_CPUS	64
+
+struct tpart {
+	int cpu;
+	int segs;
+	struct mmap map[MAX_MEM_SEGMENTS];
+	unsigned int seedx, seedy;	/* for rand_next() */
+	int sense;			/* for barrier() */
+};
+
+extern int ncpus;
+extern struct tpart parts[MAX_CPUS];
+
+void smp_partition(void);
+void smp_run(void (*fn)(struct tpart *tp));
+void barrier(struct tpart *tp);
+void tick(struct tpart *tp);
+
+static inline void spin_lock(volatile int *lock)
+{
+	while (__sync_lock_test_and_set(lock, 1)) {
+		while (*lock)
+			;
+	}
+}
+static inline void spin_unlock(volatile int *lock)
+{
+	__sync_lock_release(lock);
+}
+#endif
+
 #define FIRMWARE_UNKNOWN   0
 #define FIRMWARE_PCBIOS    1
 #define FIRMWARE_LINUXBIOS 2
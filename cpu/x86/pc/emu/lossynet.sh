@@ -0,0 +1,62 @@
+#!/bin/sh
+# Test network for the firmware TCP stack under loss and delay.
+#
+# Creates a tap interface for QEMU, makes it drop and delay packets in
+# both directions with netem, and serves a directory over HTTP on it.
+# Run it as root:
+#
+#   sh lossynet.sh [loss-percent [delay-ms [directory]]]
+#
+# then start the emulator firmware on the tap, for example:
+#
+#   qemu-system-i386 -bios emuofw.rom \
+#     -netdev tap,id=n0,ifname=ofwtap0,script=no,downscript=no \
+#     -device ne2k_pci,netdev=n0
+#
+# and at the ok prompt, with a bigger window to exercise scaling:
+#
+#   ok setenv tcp-window 262144
+#   ok load http:\\10.77.0.1:8000\bigfile
+#
+# The firmware gets its address from dnsmasq on the tap.  Look at a
+# capture on the tap, e.g.
+#
+#   tcpdump -i ofwtap0 -w lossy.pcap
+#
+# for SACK blocks in the firmware's ACKs and for resends of only the
+# missing segments.  Ctrl-C removes the tap.
+
+LOSS=${1:-2}
+DELAY=${2:-50}
+DIR=${3:-.}
+TAP=ofwtap0
+HOST=10.77.0.1
+
+ip tuntap add dev $TAP mode tap || exit 1
+trap 'ip link del $TAP' EXIT INT TERM
+ip addr add $HOST/24 dev $TAP
+ip link set $TAP up
+
+# Stop rather than serve a network without the loss and delay
+die() { echo "lossynet: $*" >&2; exit 1; }
+
+# Outgoing to the firmware
+tc qdisc add dev $TAP root netem loss $LOSS% delay ${DELAY}ms ||
+   die "the kernel has no netem (sch_netem)"
+# Incoming from the firmware, through an ifb device
+modprobe ifb numifbs=1 2>/dev/null || ip link add ifb0 type ifb 2>/dev/null
+ip link set ifb0 up || die "the kernel has no ifb"
+tc qdisc add dev $TAP handle ffff: ingress &&
+tc filter add dev $TAP parent ffff: protocol ip u32 match u32 0 0 \
+   action mirred egress redirect dev ifb0 ||
+   die "the kernel has no mirred action (act_mirred)"
+tc qdisc add dev ifb0 root netem loss $LOSS% delay ${DELAY}ms || exit 1
+trap 'tc qdisc del dev ifb0 root; ip link del $TAP' EXIT INT TERM
+
+command -v dnsmasq >/dev/null || die "dnsmasq is needed for DHCP"
+dnsmasq --keep-in-foreground --port=0 --interface=$TAP --bind-interfaces \
+   --dhcp-range=10.77.0.10,10.77.0.50 &
+trap 'kill $!; tc qdisc del dev ifb0 root; ip link del $TAP' EXIT INT TERM
+
+echo "Serving $DIR on http://$HOST:8000 with $LOSS% loss, ${DELAY}ms delay"
+cd "$DIR" && python3 -m http.server --bind $HOST 8000
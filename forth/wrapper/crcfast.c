@@ -0,0 +1,229 @@
+/*
+ * Fast CRC-32 for the wrapper
+ *
+ * The zip CRC (the polynomial of forth/lib/crc32.fth and inflate.c),
+ * with the same calling convention as zlib's crc32(): the caller passes
+ * the CRC of the data so far, starting from 0, and gets back the CRC
+ * with the new data included.
+ *
+ * The portable version is "slice-by-8": eight 256-entry tables let it
+ * fold in eight bytes per step with independent lookups, instead of
+ * one byte per step with each lookup waiting for the last.  Where the
+ * host processor can do better, a version that uses its instructions
+ * is chosen the first time crc32_fast() runs:
+ *	x86	PCLMULQDQ carry-less multiplies, folding 64 bytes per step
+ *		(the method of Intel's "Fast CRC Computation for Generic
+ *		Polynomials Using PCLMULQDQ Instruction").
+ *	ARMv8	The CRC32 instructions, eight bytes per instruction.
+ * The SSE4.2 CRC32 instruction computes a different CRC (Castagnoli),
+ * so it is no use here.
+ */
+
+#include <stddef.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define	CRC_PCLMUL
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+#define	CRC_ARMV8
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define	HWCAP_CRC32	(1 << 7)
+#endif
+#endif
+
+typedef unsigned int u32;
+
+static u32 crc_table[8][256];
+static u32 (*crc_fn)(u32, const unsigned char *, unsigned long);
+
+static void
+make_tables(void)
+{
+	u32 c;
+	int i, k;
+
+	for (i = 0; i < 256; i++) {
+		c = i;
+		for (k = 0; k < 8; k++)
+			c = c & 1 ? (c >> 1) ^ 0xedb88320 : c >> 1;
+		crc_table[0][i] = c;
+	}
+	/* table k advances a byte that is followed by k more */
+	for (i = 0; i < 256; i++) {
+		c = crc_table[0][i];
+		for (k = 1; k < 8; k++) {
+			c = crc_table[0][c & 0xff] ^ (c >> 8);
+			crc_table[k][i] = c;
+		}
+	}
+}
+
+/* CRC register in and out, without the pre- and post-conditioning */
+static u32
+crc_slice8(u32 c, const unsigned char *p, unsigned long n)
+{
+	u32 hi;
+
+	for (; n && ((size_t)p & 3); n--)
+		c = crc_table[0][(c ^ *p++) & 0xff] ^ (c >> 8);
+
+	for (; n >= 8; n -= 8, p += 8) {
+		c ^= p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24);
+		hi = p[4] | (p[5] << 8) | (p[6] << 16) | ((u32)p[7] << 24);
+		c = crc_table[7][c & 0xff] ^ crc_table[6][(c >> 8) & 0xff]
+		    ^ crc_table[5][(c >> 16) & 0xff] ^ crc_table[4][c >> 24]
+		    ^ crc_table[3][hi & 0xff] ^ crc_table[2][(hi >> 8) & 0xff]
+		    ^ crc_table[1][(hi >> 16) & 0xff] ^ crc_table[0][hi >> 24];
+	}
+
+	for (; n; n--)
+		c = crc_table[0][(c ^ *p++) & 0xff] ^ (c >> 8);
+	return (c);
+}
+
+#ifdef CRC_PCLMUL
+/*
+ * Folding constants for the bit-reflected polynomial: x^(4*128+32),
+ * x^(4*128-32), x^(128+32), x^(128-32) and x^64 mod P, then P and
+ * floor(x^64 / P) for the final Barrett reduction.
+ */
+__attribute__((target("pclmul,sse4.1")))
+static u32
+crc_pclmul(u32 c, const unsigned char *p, unsigned long n)
+{
+	__m128i x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+	__m128i k1k2, k3k4, k5, poly, mask;
+
+	if (n < 64)
+		return (crc_slice8(c, p, n));
+
+	k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+	k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+	k5 = _mm_set_epi64x(0, 0x0163cd6124LL);
+	poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+	mask = _mm_setr_epi32(~0, 0, ~0, 0);
+
+	x1 = _mm_loadu_si128((const __m128i *)(p + 0x00));
+	x2 = _mm_loadu_si128((const __m128i *)(p + 0x10));
+	x3 = _mm_loadu_si128((const __m128i *)(p + 0x20));
+	x4 = _mm_loadu_si128((const __m128i *)(p + 0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(c));
+	p += 64;
+	n -= 64;
+
+	/* fold four lanes of 128 bits, 64 bytes per step */
+	while (n >= 64) {
+		x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+		y5 = _mm_loadu_si128((const __m128i *)(p + 0x00));
+		y6 = _mm_loadu_si128((const __m128i *)(p + 0x10));
+		y7 = _mm_loadu_si128((const __m128i *)(p + 0x20));
+		y8 = _mm_loadu_si128((const __m128i *)(p + 0x30));
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+		p += 64;
+		n -= 64;
+	}
+
+	/* fold the four lanes into one */
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	/* then 16 bytes per step */
+	while (n >= 16) {
+		x2 = _mm_loadu_si128((const __m128i *)p);
+		x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+		p += 16;
+		n -= 16;
+	}
+
+	/* reduce 128 bits to 64 */
+	x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+	x1 = _mm_srli_si128(x1, 8);
+	x1 = _mm_xor_si128(x1, x2);
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, mask);
+	x1 = _mm_clmulepi64_si128(x1, k5, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	/* and 64 to 32 */
+	x2 = _mm_and_si128(x1, mask);
+	x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+	x2 = _mm_and_si128(x2, mask);
+	x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+	c = _mm_extract_epi32(x1, 1);
+
+	return (crc_slice8(c, p, n));
+}
+#endif
+
+#ifdef CRC_ARMV8
+__attribute__((target("+crc")))
+static u32
+crc_armv8(u32 c, const unsigned char *p, unsigned long n)
+{
+	for (; n && ((size_t)p & 7); n--)
+		c = __crc32b(c, *p++);
+	for (; n >= 8; n -= 8, p += 8)
+		c = __crc32d(c, *(const unsigned long long *)p);
+	for (; n; n--)
+		c = __crc32b(c, *p++);
+	return (c);
+}
+#endif
+
+static void
+choose(void)
+{
+	make_tables();
+	crc_fn = crc_slice8;
+#ifdef CRC_PCLMUL
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1"))
+		crc_fn = crc_pclmul;
+#endif
+#ifdef CRC_ARMV8
+	if (getauxval(AT_HWCAP) & HWCAP_CRC32)
+		crc_fn = crc_armv8;
+#endif
+}
+
+/*
+ * Call once before any threads might call crc32_fast() at the same time.
+ */
+void
+crc32_fast_init(void)
+{
+	if (crc_fn == NULL)
+		choose();
+}
+
+unsigned long
+crc32_fast(unsigned long crc, const unsigned char *buf, unsigned long len)
+{
+	if (crc_fn == NULL)
+		choose();
+	return (crc_fn(crc ^ 0xffffffff, buf, len) ^ 0xffffffff);
+}
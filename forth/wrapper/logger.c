@@ -19,6 +19,14 @@
 #ifndef USE_STDIO
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <fcntl.h>
+#endif
+#ifndef _O_BINARY
+# ifdef O_BINARY
+#  define _O_BINARY O_BINARY
+# else
+#  define _O_BINARY 0
+# endif
 #endif
 #include <time.h>
 #ifdef MAJC
@@ -71,8 +79,180 @@ char *rootname(char *filename)
 }
 
 
+/*
+ * Input files are identified by a 64-bit FNV-1a hash of their contents,
+ * so that a snapshot of the dictionary state can be keyed by the exact
+ * set of files it was compiled from.
+ */
+typedef unsigned long long hash_t;
+#define FNV_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+hash_t hash_bytes(hash_t h, char *p, long len);
+hash_t hash_bytes(hash_t h, char *p, long len)
+{
+    while (len-- > 0) {
+        h ^= (unsigned char)*p++;
+        h *= FNV_PRIME;
+    }
+    return (h);
+}
+
+#ifndef USE_STDIO
+/* Hashes the contents of an open file, leaving it positioned at the start */
+hash_t hash_fd(long fd);
+hash_t hash_fd(long fd)
+{
+    char buf[8192];
+    long len;
+    hash_t h = FNV_BASIS;
+
+    (void) lseek((int)fd, (off_t)0, SEEK_SET);
+    while ((len = (long)read((int)fd, buf, sizeof(buf))) > 0)
+        h = hash_bytes(h, buf, len);
+    (void) lseek((int)fd, (off_t)0, SEEK_SET);
+    return (h);
+}
+
+/*
+ * Rehashing every input file each time the builder checks a target
+ * would cost as much as reading it, so hashes are cached by (device,
+ * inode, modification time, size).  If OFW_HASHCACHE names a file, the
+ * cache persists there across runs, with new entries appended to it.
+ * A later entry for the same file supersedes an earlier one, and the
+ * file is rewritten when superseded entries make up most of it.
+ */
+typedef unsigned long long ull;
+typedef struct hentry {
+    struct hentry *link;
+    ull dev, ino, mtime, size;
+    hash_t hash;
+} hentry;
+
+#define HCACHE_SIZE 1024
+hentry *hcache[HCACHE_SIZE];
+int hcache_loaded = 0;
+
+hentry **hcache_bucket(ull dev, ull ino);
+hentry **hcache_bucket(ull dev, ull ino)
+{
+    return (&hcache[(ino ^ (dev << 5)) % HCACHE_SIZE]);
+}
+
+/* Returns 1 if a new entry was made, 0 if an existing one was replaced */
+int hcache_insert(ull dev, ull ino, ull mtime, ull size, hash_t hash);
+int hcache_insert(ull dev, ull ino, ull mtime, ull size, hash_t hash)
+{
+    hentry *e, **bucket;
+
+    bucket = hcache_bucket(dev, ino);
+    for (e = *bucket; e != NULL; e = e->link)
+        if (e->dev == dev && e->ino == ino) {
+            e->mtime = mtime;  e->size = size;  e->hash = hash;
+            return (0);
+        }
+    if ((e = (hentry *)malloc(sizeof(hentry))) == NULL)
+        return (0);
+    e->dev = dev;  e->ino = ino;  e->mtime = mtime;  e->size = size;
+    e->hash = hash;
+    e->link = *bucket;
+    *bucket = e;
+    return (1);
+}
+
+/* Writes the cache to a temporary file and renames it over 'name' */
+void hcache_save(char *name);
+void hcache_save(char *name)
+{
+    char tmpname[MAXPATHLEN+20];
+    FILE *file;
+    hentry *e;
+    int i;
+
+    sprintf(tmpname, "%.*s.%d", MAXPATHLEN, name, (int)getpid());
+    if ((file = fopen(tmpname, "w")) == NULL)
+        return;
+    for (i = 0; i < HCACHE_SIZE; i++)
+        for (e = hcache[i]; e != NULL; e = e->link)
+            fprintf(file, "%llx %llx %llx %llx %016llx\n",
+                    e->dev, e->ino, e->mtime, e->size, e->hash);
+    if (fclose(file) != 0 || rename(tmpname, name) != 0)
+        (void) unlink(tmpname);
+}
+
+void hcache_load(void);
+void hcache_load(void)
+{
+    char *name;
+    FILE *file;
+    ull dev, ino, mtime, size;
+    hash_t hash;
+    long lines = 0, entries = 0;
+
+    hcache_loaded = 1;
+    if ((name = getenv("OFW_HASHCACHE")) == NULL
+    ||  (file = fopen(name, "r")) == NULL)
+        return;
+    while (fscanf(file, "%llx %llx %llx %llx %llx\n",
+                  &dev, &ino, &mtime, &size, &hash) == 5) {
+        lines++;
+        entries += hcache_insert(dev, ino, mtime, size, hash);
+    }
+    fclose(file);
+    if (lines > 2 * entries + 64)
+        hcache_save(name);
+}
+
+/*
+ * Like hash_fd, but consults the cache first.  Files other than regular
+ * files (devices, pipes) are not read; they all hash to 0.
+ */
+hash_t hash_cached(long fd);
+hash_t hash_cached(long fd)
+{
+    struct stat stbuf;
+    hentry *e;
+    char *name;
+    FILE *file;
+    hash_t hash;
+
+    if (fstat((int)fd, &stbuf) != 0)
+        return (hash_fd(fd));
+    if (!S_ISREG(stbuf.st_mode))
+        return (0);
+
+    if (!hcache_loaded)
+        hcache_load();
+
+    for (e = *hcache_bucket(stbuf.st_dev, stbuf.st_ino); e != NULL; e = e->link)
+        if (e->dev == (ull)stbuf.st_dev && e->ino == (ull)stbuf.st_ino
+        &&  e->mtime == (ull)stbuf.st_mtime && e->size == (ull)stbuf.st_size)
+            return (e->hash);
+
+    hash = hash_fd(fd);
+    hcache_insert(stbuf.st_dev, stbuf.st_ino, stbuf.st_mtime, stbuf.st_size, hash);
+    if ((name = getenv("OFW_HASHCACHE")) != NULL
+    &&  (file = fopen(name, "a")) != NULL) {
+        fprintf(file, "%llx %llx %llx %llx %016llx\n",
+                (ull)stbuf.st_dev, (ull)stbuf.st_ino,
+                (ull)stbuf.st_mtime, (ull)stbuf.st_size, hash);
+        fclose(file);
+    }
+    return (hash);
+}
+#endif
+
 /* Log records are maintained as a linked list. */
-typedef struct node { struct node *link; char info[1]; } node;
+typedef struct node {
+    struct node *link;
+    char *name;		/* Input files: the name as given */
+    char *path;		/* Where to find it to hash it, until it's hashed */
+    long size;
+    time_t mtime;
+    int hashed;		/* Nonzero if 'hash' holds the content hash */
+    hash_t hash;
+    char info[1];
+} node;
 typedef struct list { node *first; node *last; } list;
 
 list infiles = { NULL, NULL };	/* List of log records for input files */
@@ -84,9 +264,13 @@ void record(list *list);
 void record(list *list)
 {
     node *new;
-    new = (node *)malloc(strlen(info) + sizeof(node *) + 1);
+    new = (node *)malloc(strlen(info) + sizeof(node) + 1);
     strcpy(new->info, info);
     new->link = NULL;
+    new->name = NULL;
+    new->path = NULL;
+    new->hashed = 0;
+    new->hash = 0;
     if (list->last != NULL)
 	list->last->link = new;
     list->last = new;
@@ -109,6 +293,35 @@ node *findnode(list *list, char *s)
     return((node *)0);
 }
 
+/*
+ * Returns nonzero if the content hash of input file 'n' is known,
+ * computing it on first use.  Most runs never need the hashes, so
+ * log_input() only notes where the file is.  A file that has changed
+ * since it was loaded gets no hash.
+ */
+int node_hash(node *n);
+int node_hash(node *n)
+{
+#ifndef USE_STDIO
+    struct stat stbuf;
+    int fd;
+
+    if (n->path == NULL)
+        return (n->hashed);
+    if ((fd = open(n->path, _O_BINARY|O_RDONLY)) >= 0) {
+        if (fstat(fd, &stbuf) == 0 && (long)stbuf.st_size == n->size
+        &&  stbuf.st_mtime == n->mtime) {
+            n->hash = hash_cached((long)fd);
+            n->hashed = 1;
+        }
+        (void) close(fd);
+    }
+    free(n->path);
+    n->path = NULL;
+#endif
+    return (n->hashed);
+}
+
 /* Writes the data from each node of 'list' to the 'logfile' */
 void fputlist(list *list, FILE *logfile);
 void fputlist(list *list, FILE *logfile)
@@ -118,6 +331,32 @@ void fputlist(list *list, FILE *logfile)
         fputs(n->info, logfile);
 }
 
+/*
+ * Writes a record for each input file to the 'logfile', of the form:
+ *   in: file-name file-size file-modification-date content-hash date-string
+ * The content hash is omitted for files that have none.
+ */
+void fputinputs(FILE *logfile);
+void fputinputs(FILE *logfile)
+{
+    node *n;
+    for (n = infiles.first; n != NULL; n = n->link) {
+#ifdef USE_STDIO
+        (void) fprintf(logfile, "in: %s\n", n->name);
+#else
+        /* ctime automatically appends a newline */
+        if (node_hash(n))
+            (void) fprintf(logfile, "in: %s  %ld  %lx  %016llx  %s",
+                           n->name, n->size, (long)n->mtime, n->hash,
+                           ctime(&n->mtime));
+        else
+            (void) fprintf(logfile, "in: %s  %ld  %lx  %s",
+                           n->name, n->size, (long)n->mtime,
+                           ctime(&n->mtime));
+#endif
+    }
+}
+
 /*
  * Writes a log file of all information accumulated to date.
  * 'filename' is the name of the Forth output file.  The name
@@ -153,44 +392,98 @@ void log_output(char *filename, long size)
 
     fputlist(&misc, logfile);
     fputlist(&envvars, logfile);
-    fputlist(&infiles, logfile);
+    fputinputs(logfile);
     fclose(logfile);
 }
 
 /*
- * Creates a log record for the input file 'filename'.
- * The record is of the form:
- *   in: file-name file-modification-date file-size
+ * Creates a log record for the input file 'filename', which is open
+ * on 'fd'.  'path' is where to reopen it to hash its contents, or NULL
+ * if its contents are not to be hashed, as for the dictionary file.
  */
-void log_input(char *filename, int fd);
-void log_input(char *filename, int fd)
+void log_input(char *filename, char *path, int fd);
+void log_input(char *filename, char *path, int fd)
 {
-#ifdef USE_STDIO
-    /* Avoid duplicate entries */
-    sprintf(info, "in: %s", filename);
-    if (findnode(&infiles, info) != (node *)0)
-	return;
-
-    sprintf(info, "in: %s\n", filename);
-    record(&infiles);
-#else
+#ifndef USE_STDIO
     struct stat stbuf;
+#endif
 
     /* Avoid duplicate entries */
     sprintf(info, "in: %s", filename);
-
     if (findnode(&infiles, info) != (node *)0)
 	return;
 
+#ifdef USE_STDIO
+    UNUSED_ARGUMENT(path);
+    UNUSED_ARGUMENT(fd);
+    record(&infiles);
+#else
     if (0 != fstat(fd,&stbuf))
         return;
 
-    /* ctime automatically appends a newline */
-    sprintf(info, "in: %s  %ld  %lx  %s",
-	    filename, (long)stbuf.st_size, (long)stbuf.st_mtime, ctime(&stbuf.st_mtime));
-
     record(&infiles);
+    infiles.last->size = (long)stbuf.st_size;
+    infiles.last->mtime = stbuf.st_mtime;
+    if (path != NULL && S_ISREG(stbuf.st_mode))
+        infiles.last->path = strdup(path);
 #endif
+    infiles.last->name = strdup(filename);
+}
+
+/* Returns the number of input files logged so far */
+long log_count(void);
+long log_count(void)
+{
+    node *n;
+    long count = 0;
+
+    for (n = infiles.first; n != NULL; n = n->link)
+        count++;
+    return (count);
+}
+
+/*
+ * Returns a digest of the names and contents of the input files logged
+ * so far, combined with 'extra'.  Build scripts (.bth files) are left
+ * out, so that editing the part of a script after the snapshot point
+ * doesn't change the key of the snapshot.  Files without a content
+ * hash, such as the dictionary, are identified by size and date.
+ */
+hash_t log_digest(char *extra);
+hash_t log_digest(char *extra)
+{
+    node *n;
+    hash_t h = FNV_BASIS;
+    int len;
+
+    for (n = infiles.first; n != NULL; n = n->link) {
+        len = strlen(n->name);
+        if (len > 4 && strcmp(n->name + len - 4, ".bth") == 0)
+            continue;
+        h = hash_bytes(h, n->name, len + 1);
+        if (node_hash(n)) {
+            h = hash_bytes(h, (char *)&n->hash, sizeof(n->hash));
+        } else {
+            h = hash_bytes(h, (char *)&n->size, sizeof(n->size));
+            h = hash_bytes(h, (char *)&n->mtime, sizeof(n->mtime));
+        }
+    }
+    return (hash_bytes(h, extra, strlen(extra) + 1));
+}
+
+/*
+ * Writes a record "in: file-name content-hash" for each input file
+ * after the first 'skip' ones.  The hash is 0 for files without one.
+ */
+void log_manifest(FILE *file, long skip);
+void log_manifest(FILE *file, long skip)
+{
+    node *n;
+
+    for (n = infiles.first; n != NULL; n = n->link)
+        if (--skip < 0)
+            fprintf(file, "in: %s %016llx\n", n->name,
+                    node_hash(n) ? n->hash : 0ULL);
 }
 
 /*
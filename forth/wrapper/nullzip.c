@@ -1,6 +1,7 @@
 /*
- * Stub versions of zip_memory() and inflate() for organizations
- * immune to the license of the code that implementes zip_memory()
+ * Stub versions of zip_memory(), inflate(), lz4_compress() and pdeflate()
+ * for organizations immune to the license of the code that implementes
+ * zip_memory()
  */
 zip_memory()
 {
@@ -9,3 +10,13 @@ zip_memory()
 inflate()
 {
 }
+
+lz4_compress()
+{
+	return 0;
+}
+
+pdeflate()
+{
+	return 0;
+}
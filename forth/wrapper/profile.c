@@ -0,0 +1,303 @@
+// See license at end of file
+
+/*
+ * Forth-aware guest profiler for the instruction set simulators
+ * (cpu/arm/armsim.c and cpu/ppc/ppcsim/ppcsim.c).
+ *
+ * When profiling, each guest instruction is charged to the Forth word
+ * most recently entered through NEXT, and every PROFILE_PERIOD
+ * instructions the simulator walks its return stack and records the
+ * chain of colon definitions it finds.  At exit, <prefix>.flat gets a
+ * flat profile and <prefix>.folded gets the samples as collapsed stacks
+ * for flamegraph.pl.
+ *
+ * The simulator calls, with guest addresses:
+ *	prof_init(start, mem)		when it finds its profile variable set
+ *	prof_enter(cfa)			when NEXT enters the code of a word
+ *	prof_docolon(slot, ip, cfa)	when docolon pushes ip at slot
+ *	prof_tick()			before each instruction; when it
+ *					returns nonzero, the simulator walks
+ *					its return stack from prof_top(rp)
+ *					down to rp, calling prof_frame(slot,
+ *					contents) for each slot, and then
+ *					calls prof_record()
+ *
+ * Words are named from their headers as find() sees them: the link field
+ * is just below the code field and the name-length byte just below that.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROFILE_PERIOD  1000	/* Instructions per stack sample */
+#define PROF_WORDS   0x10000	/* Must be a power of 2 */
+#define PROF_FRAMES  0x1000	/* Must be a power of 2 */
+#define PROF_STACKS  0x10000	/* Must be a power of 2 */
+#define PROF_DEPTH   64		/* Deepest stack recorded */
+
+typedef unsigned long gaddr;	/* Guest address */
+
+char *profiling;		/* Output file prefix, or 0 */
+static unsigned char *profmem;	/* Guest memory, for names */
+
+static struct profword {
+	gaddr cfa;
+	unsigned long long count;
+} profwords[PROF_WORDS];
+static unsigned long nprofwords;
+static struct profword *curword;	/* Word being charged for instructions */
+
+/*
+ * Shadow return stack.  For each slot that docolon pushed, the IP it saved
+ * and the colon definition being entered.  Slots below RP have been popped,
+ * and a slot whose contents no longer match the saved IP (>r data, throw,
+ * ...) is ignored, so exits need no tracking.
+ */
+static struct profframe {
+	gaddr slot;
+	gaddr ip;
+	gaddr colon;
+} profframes[PROF_FRAMES];
+static gaddr rptop;		/* Highest return stack slot seen */
+
+#define PROF_FRAME(slot)  (&profframes[((slot) >> 2) & (PROF_FRAMES - 1)])
+
+static struct profstack {
+	unsigned long hash;
+	unsigned long count;
+	unsigned long depth;
+	gaddr *cfas;		/* Outermost first */
+} profstacks[PROF_STACKS];
+static unsigned long nprofstacks;
+static unsigned long prof_countdown = PROFILE_PERIOD;
+
+/* The stack being sampled */
+static gaddr sample[PROF_DEPTH + 1];
+static unsigned long sampledepth;
+
+static struct profword *
+prof_word(gaddr cfa)
+{
+	unsigned long i;
+
+	for (i = (cfa >> 2) & (PROF_WORDS - 1); profwords[i].cfa != cfa;
+	     i = (i + 1) & (PROF_WORDS - 1)) {
+		if (profwords[i].cfa == 0) {
+			if (nprofwords == PROF_WORDS - 1)
+				return (curword);	/* Full */
+			nprofwords++;
+			profwords[i].cfa = cfa;
+			break;
+		}
+	}
+	return (&profwords[i]);
+}
+
+/* NEXT is entering the code of the word at cfa */
+void
+prof_enter(gaddr cfa)
+{
+	curword = prof_word(cfa);
+}
+
+/* docolon has pushed ip on the return stack at slot to enter cfa */
+void
+prof_docolon(gaddr slot, gaddr ip, gaddr cfa)
+{
+	struct profframe *fp = PROF_FRAME(slot);
+
+	fp->slot  = slot;
+	fp->ip    = ip;
+	fp->colon = cfa;
+	if (slot > rptop)
+		rptop = slot;
+}
+
+/* Charge an instruction; returns nonzero when a stack sample is due */
+int
+prof_tick(void)
+{
+	curword->count++;
+	if (--prof_countdown)
+		return (0);
+	prof_countdown = PROFILE_PERIOD;
+	return (1);
+}
+
+/*
+ * The return stack slot to start a walk down to rp from.  Frames far
+ * above rp belong to a stack that has since been switched away from.
+ */
+gaddr
+prof_top(gaddr rp)
+{
+	if (rptop >= rp && rptop - rp >= PROF_FRAMES * 4)
+		return (rp + PROF_FRAMES * 4 - 4);
+	return (rptop);
+}
+
+/* The return stack slot at slot holds contents; outermost first */
+void
+prof_frame(gaddr slot, gaddr contents)
+{
+	struct profframe *fp = PROF_FRAME(slot);
+
+	if (fp->slot == slot && fp->ip == contents && sampledepth < PROF_DEPTH)
+		sample[sampledepth++] = fp->colon;
+}
+
+/* Record the stack from prof_frame(), ending in the current word */
+void
+prof_record(void)
+{
+	unsigned long depth, hash, i;
+	struct profstack *sp;
+
+	depth = sampledepth;
+	sampledepth = 0;
+	if (depth == 0 || sample[depth - 1] != curword->cfa)
+		sample[depth++] = curword->cfa;
+
+	hash = 2166136261U;		/* FNV-1a */
+	for (i = 0; i < depth; i++)
+		hash = (hash ^ sample[i]) * 16777619;
+
+	for (i = hash & (PROF_STACKS - 1); ; i = (i + 1) & (PROF_STACKS - 1)) {
+		sp = &profstacks[i];
+		if (sp->cfas == 0) {
+			if (nprofstacks == PROF_STACKS - 1)
+				return;
+			nprofstacks++;
+			sp->hash = hash;
+			sp->depth = depth;
+			sp->cfas = (gaddr *)malloc(depth * sizeof(gaddr));
+			memcpy(sp->cfas, sample, depth * sizeof(gaddr));
+			break;
+		}
+		if (sp->hash == hash && sp->depth == depth
+		    && memcmp(sp->cfas, sample, depth * sizeof(gaddr)) == 0)
+			break;
+	}
+	sp->count++;
+}
+
+/*
+ * Print the name of the word whose code field is at cfa.  Collapsed stack
+ * files use ; as the frame separator, so it is written as %3b there.
+ */
+static void
+prof_name(FILE *f, gaddr cfa, int folded)
+{
+	unsigned char *np, *cp;
+	unsigned long len = 0;
+
+	if (cfa >= 5 + 0x1f) {
+		np = &profmem[cfa - 5];
+		len = *np & 0x1f;
+		for (cp = np - len; cp < np; cp++)
+			if (*cp <= ' ' || *cp > '~')
+				len = 0;
+	}
+	if (len == 0) {
+		fprintf(f, "0x%lx", cfa);
+		return;
+	}
+	for (np -= len; len--; np++)
+		if (folded && *np == ';')
+			fputs("%3b", f);
+		else
+			putc(*np, f);
+}
+
+static int
+prof_compare(const void *a, const void *b)
+{
+	unsigned long long ca = ((struct profword *)a)->count;
+	unsigned long long cb = ((struct profword *)b)->count;
+
+	return ((ca < cb) ? 1 : (ca > cb) ? -1 : 0);
+}
+
+static void
+prof_report(void)
+{
+	char *filename;
+	FILE *f;
+	unsigned long long total;
+	unsigned long i, j;
+
+	filename = malloc(strlen(profiling) + sizeof(".folded"));
+
+	qsort(profwords, PROF_WORDS, sizeof(struct profword), prof_compare);
+	total = 0;
+	for (i = 0; i < nprofwords; i++)
+		total += profwords[i].count;
+
+	sprintf(filename, "%s.flat", profiling);
+	if ((f = fopen(filename, "w")) == NULL) {
+		perror(filename);
+		return;
+	}
+	fprintf(f, "# %llu guest instructions\n", total);
+	for (i = 0; i < nprofwords && profwords[i].count; i++) {
+		fprintf(f, "%12llu %6.2f%%  ", profwords[i].count,
+			(profwords[i].count * 100.0) / total);
+		prof_name(f, profwords[i].cfa, 0);
+		putc('\n', f);
+	}
+	fclose(f);
+
+	sprintf(filename, "%s.folded", profiling);
+	if ((f = fopen(filename, "w")) == NULL) {
+		perror(filename);
+		return;
+	}
+	for (i = 0; i < PROF_STACKS; i++) {
+		if (profstacks[i].count == 0)
+			continue;
+		for (j = 0; j < profstacks[i].depth; j++) {
+			if (j)
+				putc(';', f);
+			prof_name(f, profstacks[i].cfas[j], 1);
+		}
+		fprintf(f, " %lu\n", profstacks[i].count);
+	}
+	fclose(f);
+}
+
+/*
+ * Start profiling into the files named by the prefix in profiling.
+ * mem[adr] is the byte at guest address adr.
+ */
+void
+prof_init(gaddr start, unsigned char *mem)
+{
+	profmem = mem;
+	curword = prof_word(start);
+	atexit(prof_report);
+}
+
+// LICENSE_BEGIN
+// Copyright (c) 2006 FirmWorks
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// LICENSE_END
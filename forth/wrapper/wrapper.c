@@ -58,6 +58,7 @@ which is part of the Forth image file.
 #include <unistd.h>
 #ifndef WIN32
 #include <sys/mman.h>
+#include <sys/wait.h>
 #endif
 
 /* 
@@ -68,8 +69,11 @@ which is part of the Forth image file.
 #include <ctype.h>
 /* zlib externs */
 extern int inflate();
+extern unsigned long lz4_compress();
+extern unsigned long pdeflate();
 extern int compress();
 extern long crc32();
+extern unsigned long crc32_fast();
 
 #ifdef __linux__
 char *host_os = "Linux";
@@ -272,6 +276,25 @@ typedef long quadlet;
 # include <stdio.h>
 #endif
 
+/*
+ * On Unix hosts the dictionary is read into demand-zero memory rather
+ * than into zeroed malloc memory; see map_dictionary().
+ */
+#if defined(__unix__) && !defined(USE_STDIO) && !defined(TARGET_X86)
+# define MAP_DICTIONARY
+# ifndef MAP_ANONYMOUS
+#  define MAP_ANONYMOUS MAP_ANON
+# endif
+#endif
+
+/*
+ * Warm-start snapshots re-execute the wrapper, so they are only
+ * supported on Unix hosts; see w_start().
+ */
+#if defined(__unix__) && !defined(USE_STDIO)
+# define WARM_START
+#endif
+
 /* fcntl.h will define this if the system needs it; otherwise we use 0 */
 #ifndef _O_BINARY
 # ifdef O_BINARY
@@ -326,9 +349,12 @@ typedef long quadlet;
 extern char *rootname(char *);
 extern char *basename(char *);
 extern void log_output(char *, long);
-extern void log_input(char *, int);
+extern void log_input(char *, char *, int);
 extern void log_command_line(int, char **);
 extern void log_env(char *, char *);
+#ifndef USE_STDIO
+extern unsigned long long hash_cached(long);
+#endif
 
 INTERNAL char *	substr();
 INTERNAL long	path_open();
@@ -396,6 +422,17 @@ INTERNAL long   m_unmap();
 INTERNAL long   s_ioperm();
 INTERNAL long   f_mkdir();
 INTERNAL long   f_rmdir();
+INTERNAL long   w_start();
+INTERNAL long   w_save();
+INTERNAL long   w_saved();
+INTERNAL long   s_spawn();
+INTERNAL long   s_wait();
+INTERNAL long   s_status();
+INTERNAL long   f_hash();
+INTERNAL long   m_lz4();
+INTERNAL long   m_inflate_stream();
+INTERNAL long   m_pdeflate();
+INTERNAL long   m_crc32();
 #ifdef DLOPEN
 extern   long	dlopen(), dlsym(), dlerror(), dlclose();
 #endif
@@ -540,7 +577,18 @@ long (*functions[])() = {
 #ifdef USE_XCB
 	/* 392       396           400       404 */
 	open_window, close_window, rgbcolor, fill_rectangle,
+#else
+	0,           0,            0,        0,
 #endif
+
+	/* 408       412      416 */
+	w_start,     w_save,  w_saved,
+
+	/* 420       424      428       432 */
+	s_spawn,     s_wait,  s_status, f_hash,
+
+	/* 436       440               444         448 */
+	m_lz4,       m_inflate_stream, m_pdeflate, m_crc32,
 };
 /*
  * Function semantics:
@@ -572,6 +620,36 @@ long (*functions[])() = {
  * long f_crstr()				Returns file line terminator.
  * long syserror();				Error code from the last
  *	failed system call.
+ * long w_start(char *prefix, char *dir);	Looks for a snapshot of the
+ *	dictionary with 'prefix' loaded.  Returns 1 if this dictionary
+ *	is that snapshot, 0 if the prefix must be loaded, and does not
+ *	return if a valid snapshot exists.
+ * long w_save(char *path);			Gets the snapshot file name.
+ * long w_saved(long ok);			Records a completed snapshot.
+ * long s_spawn(char *cmd);			Starts a shell command without
+ *	waiting for it.  Returns its process id, or -1.
+ * long s_wait();				Waits for any spawned command to
+ *	finish.  Returns its process id, or -1 if there are none.
+ * long s_status();				Exit status from the last s_wait.
+ * long f_hash(char *path, char *buf);		Puts the content hash that
+ *	the logger records for the file into buf as 16 hex digits.
+ * long m_lz4(long outlen, char *out, long inlen, char *in);
+ *	Compresses in into an LZ4 frame for unlz4.bin.  Returns the
+ *	frame length, or 0 if it does not fit in outlen bytes.
+ * long m_inflate_stream(long op, char *zs, char *ws);
+ *	Runs the streaming decoder in inflate.c on the zstream at zs,
+ *	with the workspace at ws.  See inflate_stream() for the ops and
+ *	return codes.
+ * long m_pdeflate(long nthreads, long outlen, char *out, long inlen,
+ *		   char *in);
+ *	Like m_deflate, but compresses blocks of the input on nthreads
+ *	threads, or one per processor if nthreads is 0.  The result is
+ *	a single gzip stream.  Returns its length, or 0 if it does not
+ *	fit in outlen bytes.
+ * long m_crc32(long len, char *adr, long crc);
+ *	Continues the zip CRC-32 register crc over len bytes at adr, as
+ *	($crc) in forth/lib/crc32.fth does, with the fastest method
+ *	that the host processor supports.
  */
 
 #ifdef TARGET_X86
@@ -588,6 +666,13 @@ char *progname;
 char sccs_get_cmd[128]; /* sccs get command string */
 int uflag = 0; /* controls auto execution of sccs get */
 int vflag = 0; /* controls reporting of file names */
+int warm_saving = 0; /* don't log a snapshot as the output file */
+#ifdef WARM_START
+char **main_argv;		/* Arguments for re-executing the wrapper */
+char *warm_key;			/* Key of the snapshot we are running */
+char warm_path[MAXPATHLEN];	/* Snapshot being made, less extension */
+long warm_mark = -1;		/* Inputs logged before the prefix */
+#endif
 
 INTERNAL char *expand_name();
 
@@ -652,15 +737,58 @@ qlbflips(long *adr, char *bitmap, int len)
 #endif
 
 #ifdef TARGET_X86
-int bittest(char *table, int index) 
-{
-	int quot, remain ;
-	unsigned char pattern = 128 ;
+/*
+ * The relocation bitmap has one bit for each 16-bit word of the image,
+ * most significant bit first.  Most of the map is zero, so it is scanned
+ * eight bytes at a time and only the nonzero chunks are examined bitwise.
+ */
+void relocate_bitmap(char *image, unsigned char *map, int nbits, int delta)
+{
+	unsigned long long chunk;
+	unsigned char *p;
+	int bit, b, i, end;
+
+	for (bit = 0; bit < nbits; bit += 64) {
+		memcpy(&chunk, &map[bit>>3], sizeof(chunk));
+		if (chunk == 0)
+			continue;
+		end = bit + 64;
+		if (end > nbits)
+			end = nbits;
+		for (b = bit, p = &map[bit>>3]; b < end; b += 8, p++) {
+			if (*p == 0)
+				continue;
+			for (i = 0; i < 8 && b + i < end; i++)
+				if (*p & (0x80 >> i))
+					*(int *)&image[2*(b+i)] += delta;
+		}
+	}
+}
 
-	quot = index /8 ;
-	remain = index %8 ;
+/*
+ * Newer images follow the bitmap with a sparse list of the byte offsets
+ * of the relocated longwords, which is applied directly.  The list is
+ * ignored unless it is complete and every offset lies within the code.
+ */
+#define RELOC_LIST_MAGIC 0x4c4c4552	/* "RELL" */
+
+int relocate_list(char *image, int *list, char *limit, int code_size,
+		  int delta)
+{
+	int count, i;
 
-	return( ( table[quot] & (pattern>>remain) ) !=0 ) ;
+	if ((char *)&list[2] > limit || list[0] != RELOC_LIST_MAGIC)
+		return 0;
+	count = list[1];
+	if (count < 0 || count > (limit - (char *)&list[2]) / 4)
+		return 0;
+	list += 2;
+	for (i = 0; i < count; i++)
+		if ((unsigned)list[i] > (unsigned)code_size - 4)
+			return 0;
+	for (i = 0; i < count; i++)
+		*(int *)&image[list[i]] += delta;
+	return 1;
 }
 
 	/* Header for PharLap flat 32-bit executable file */
@@ -767,6 +895,12 @@ modify_command_line(int argc, char *argv[], char *targv[])
 
 	strcpy(dictname, "${HOSTDIR}/../build/builder.dic");
 
+	if (argn + 1 < argc && strcmp(argv[argn], "-j") == 0) {
+		sprintf(command + strlen(command), "d# %d jobs ",
+			atoi(argv[argn + 1]));
+		argn += 2;
+	}
+
 	if (argn < argc && strcmp(argv[argn], "-t") == 0) {
 		++argn;
 		strcat(command, "tag ");
@@ -801,6 +935,37 @@ strlower(char *str)
 	return(str);
 }
 
+#ifdef MAP_DICTIONARY
+/*
+ * Reserve memsize bytes of demand-zero memory and read the first filesize
+ * bytes of the dictionary file into the start of it, so that startup time
+ * doesn't depend on the size of the growth area.  The image is copied,
+ * not mapped from the file: a Forth that saves over its own dictionary
+ * file truncates it, and mapped pages that it had not yet written would
+ * then change or fault under it.  Returns the load address, or NULL if
+ * the memory can't be had or the file is too short, in which case the
+ * caller reads it the old way.
+ */
+INTERNAL char *
+map_dictionary(long fd, long filesize, long memsize)
+{
+	char *adr;
+
+	adr = mmap((void *)0, (size_t)memsize,
+		   PROT_READ | PROT_WRITE | PROT_EXEC,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, (off_t)0);
+	if (adr == MAP_FAILED)
+		return NULL;
+
+	if (pread((int)fd, adr, (size_t)filesize, (off_t)0) != filesize) {
+		(void)munmap(adr, (size_t)memsize);
+		return NULL;
+	}
+
+	return adr;
+}
+#endif
+
 int
 main(int argc, char **argv
 #ifdef EMACS
@@ -817,7 +982,8 @@ main(int argc, char **argv
 #ifdef TARGET_X86
 	char *reloc_table ;
 	int delta_org, old_org, code_size ;
-	int code_wsize, i ;
+	int map_size ;
+	long nread ;
 #endif
 
 	/*
@@ -829,6 +995,9 @@ main(int argc, char **argv
 	 * emulator to the wrapper binary, but the problem with that is that it
 	 * requires root to register the binding every time you start the computer.
 	 */
+#ifdef WARM_START
+	main_argv = argv;
+#endif
 	if (argc > 1 && (0 == strcmp(argv[1], "-0"))) {
 		argv += 2;
 		argc -= 2;
@@ -883,7 +1052,21 @@ main(int argc, char **argv
 		error("forth: Can't open dictionary file ",dictfile);
 		exit(1);
 	}
-	log_input(dictfile, f);
+	log_input(dictfile, NULL, f);
+
+#ifdef WARM_START
+	/* Load the snapshot that w_start() found instead */
+	if ((warm_key = getenv("OFW_WARMKEY")) != NULL) {
+		warm_key = strdup(warm_key);
+		f_close(f);
+		if ((f = (long)open(getenv("OFW_WARMSTART"), O_RDONLY)) < 0L) {
+			error("forth: Can't open snapshot ", getenv("OFW_WARMSTART"));
+			exit(1);
+		}
+		unsetenv("OFW_WARMSTART");
+		unsetenv("OFW_WARMKEY");
+	}
+#endif
 
 #ifdef SCCS
 	strcpy(sccs_get_cmd,"sccs ");
@@ -955,7 +1138,7 @@ main(int argc, char **argv
 	}
 #endif
 
-	if( f_read(f, loadaddr, dictsize) <= 0) {
+	if( (nread = f_read(f, loadaddr, dictsize)) <= 0) {
 		error("forth: Error reading dictionary file","");
 		exit(1);
 	}
@@ -966,15 +1149,14 @@ main(int argc, char **argv
 		/* Otherwise relocate lots of things via the bitmap */
 		code_size = ( (int)header.size_blocks -2)*0x200
 			+ (int)header.size_fragment ;
-		code_wsize = (code_size+1) /2 ;
+		map_size = (code_size+15) /16 ;
 		delta_org = (int)loadaddr - old_org ;
 		reloc_table = &loadaddr[code_size] ;
-		for(i=0 ; i<code_wsize ; i++) {
-			if(bittest(reloc_table, i)) {
-				*(int*)(&loadaddr[2*i]) += delta_org ;
-			}
-		}
-		memcpy(&loadaddr[dictsize], reloc_table, (code_size+15)/16);
+		if (!relocate_list(loadaddr, (int *)&reloc_table[map_size],
+				   &loadaddr[nread], code_size, delta_org))
+			relocate_bitmap(loadaddr, (unsigned char *)reloc_table,
+					(code_size+1) /2, delta_org);
+		memcpy(&loadaddr[dictsize], reloc_table, map_size);
 	}
 
 #else  // TARGET_X86	
@@ -1020,27 +1202,35 @@ main(int argc, char **argv
 #  endif
 # endif
 
+	loadaddr = NULL;
+#ifdef MAP_DICTIONARY
+	loadaddr = map_dictionary(f, (long)sizeof(header) + imagesize, memsize);
+#endif
+	if (loadaddr == NULL) {
 #if defined(__linux__) && defined(ARM)
-	/* This is a hack to make sure loadaddr is page-aligned for mprotect() in s_flushcache() */
-	loadaddr = (char *)sbrk(memsize);
+		/* This is a hack to make sure loadaddr is page-aligned for mprotect() in s_flushcache() */
+		loadaddr = (char *)sbrk(memsize);
 #else
-	loadaddr = (char *)m_alloc(memsize);
+		loadaddr = (char *)m_alloc(memsize);
 #endif
-	if ((loadaddr == (char *) -1) || (loadaddr == (char *) 0)) {
-		error("forth: Can't get memory","");
-		exit(1);
-	}
+		if ((loadaddr == (char *) -1) || (loadaddr == (char *) 0)) {
+			error("forth: Can't get memory","");
+			exit(1);
+		}
 
-	/* Align loadaddr to 16-byte boundary; some mallocs align less stringently */
-	loadaddr = (char *)(((long)loadaddr + 15) & ~15);
+		/* Align loadaddr to 16-byte boundary; some mallocs align less stringently */
+		loadaddr = (char *)(((long)loadaddr + 15) & ~15);
+
+		if( f_read(f, loadaddr+sizeof(header), imagesize) != imagesize ) {
+			error("forth: The dictionary file is too short","");
+			exit(1);
+		}
+	}
 
 	memsize -= 16;  // Leave room for initial stack pointer
-	(void)memcpy(loadaddr, (char *)&header, sizeof(header));
 
-	if( f_read(f, loadaddr+sizeof(header), imagesize) != imagesize ) {
-		error("forth: The dictionary file is too short","");
-		exit(1);
-	}
+	/* The header may have been byte-swapped above */
+	(void)memcpy(loadaddr, (char *)&header, sizeof(header));
 
 	f_close(f);
 
@@ -1843,7 +2033,7 @@ f_open(char *name, long flag, long mode)
 	result = open(newname, _O_BINARY|(int)flag, (int)mode);
 #endif
 	if (((flag & 3) == O_RDONLY) && result != -1)
-		log_input(name, result);
+		log_input(name, newname, result);
 	return((long)result);
 }
 
@@ -1857,7 +2047,7 @@ f_creat(char *name, long mode)
 
 #ifdef USE_STDIO
 	result = (int) fopen(expand_name(name), open_modes[8]);
-	if (result != -1) {
+	if (result != -1 && !warm_saving) {
 		strcpy(output_filename, name);
 		output_fd = result;
 	}
@@ -1867,7 +2057,7 @@ f_creat(char *name, long mode)
 #else
 	result = open(expand_name(name), _O_BINARY|O_RDWR|O_CREAT|O_TRUNC, (int)mode);
 #endif
-	if (result != -1) {
+	if (result != -1 && !warm_saving) {
 		strcpy(output_filename, name);
 		output_fd = result;
 	}
@@ -1875,6 +2065,24 @@ f_creat(char *name, long mode)
 	return((long)result);
 }
 
+INTERNAL long
+f_hash(char *name, char *buf)
+{
+#ifdef USE_STDIO
+	UNUSED_ARGUMENT(name);
+	UNUSED_ARGUMENT(buf);
+	return (-1L);
+#else
+	int fd;
+
+	if ((fd = open(expand_name(name), _O_BINARY|O_RDONLY)) < 0)
+		return (-1L);
+	sprintf(buf, "%016llx", hash_cached((long)fd));
+	(void)close(fd);
+	return (0L);
+#endif
+}
+
 INTERNAL long
 f_mkdir(char *name)
 {
@@ -1899,6 +2107,174 @@ f_rmdir(char *name)
 #endif
 }
 
+/*
+ * Warm-start snapshots.  A build script can load a common prefix of
+ * source files with "warm-start:" (forth/lib/warmstart.fth), which saves
+ * the resulting dictionary in the $OFW_SNAPSHOTS directory under a key
+ * derived from the contents of the files loaded so far and the prefix
+ * name.  <key>.snp lists the files that the prefix loaded and their
+ * content hashes.  On later runs, if those files are unchanged, the
+ * wrapper re-executes itself with the same arguments and environment
+ * variables telling it to load <key>.dic instead of the dictionary that
+ * was named; the log file still names the original dictionary.
+ */
+#ifdef WARM_START
+extern unsigned long long log_digest(char *);
+extern long log_count(void);
+extern void log_manifest(FILE *, long);
+
+
+/*
+ * Reads the next "in: file-name content-hash" record from a manifest.
+ * The name runs up to the last space, so it may contain spaces.
+ * Returns 1 for a record, 0 at the end of the file, -1 if malformed.
+ */
+INTERNAL int
+warm_entry(FILE *manifest, char *name, unsigned long long *hash)
+{
+	char line[MAXPATHLEN], *p;
+
+	if (fgets(line, sizeof(line), manifest) == NULL)
+		return (feof(manifest) ? 0 : -1);
+	if (strncmp(line, "in: ", 4) != 0 || strchr(line, '\n') == NULL
+	||  (p = strrchr(line, ' ')) == line + 3
+	||  sscanf(p, " %llx", hash) != 1)
+		return (-1);
+	*p = '\0';
+	strcpy(name, line + 4);
+	return (1);
+}
+
+/* True if every file in the manifest has the recorded contents */
+INTERNAL int
+warm_check(FILE *manifest)
+{
+	char *expand_name();
+	char name[MAXPATHLEN];
+	unsigned long long hash;
+	int fd, same, status;
+
+	while ((status = warm_entry(manifest, name, &hash)) > 0) {
+		if ((fd = open(expand_name(name), O_RDONLY)) < 0)
+			return (0);
+		same = hash_cached((long)fd) == hash;
+		close(fd);
+		if (!same)
+			return (0);
+	}
+	return (status == 0);
+}
+
+/* Logs the files in the manifest as inputs, as if they had been loaded */
+INTERNAL void
+warm_relog(FILE *manifest)
+{
+	char name[MAXPATHLEN];
+	unsigned long long hash;
+	long fd;
+
+	while (warm_entry(manifest, name, &hash) > 0)
+		if ((fd = f_open(name, (long)O_RDONLY, 0L)) >= 0)
+			(void)close((int)fd);
+}
+#endif
+
+INTERNAL long
+w_start(char *prefix, char *dir)
+{
+#ifdef WARM_START
+	char key[20], path[MAXPATHLEN+8];
+	struct stat stbuf;
+	FILE *manifest;
+
+	sprintf(key, "%016llx", log_digest(prefix));
+	sprintf(warm_path, "%s/%s", dir, key);
+	sprintf(path, "%s.snp", warm_path);
+	warm_mark = -1;
+
+	if ((manifest = fopen(path, "r")) != NULL) {
+		if (warm_key != NULL && strcmp(warm_key, key) == 0) {
+			warm_relog(manifest);
+			fclose(manifest);
+			return (1);
+		}
+		if (warm_check(manifest)) {
+			sprintf(path, "%s.dic", warm_path);
+			if (stat(path, &stbuf) == 0) {
+				fflush(stdout);
+				restoremode();
+				setenv("OFW_WARMSTART", path, 1);
+				setenv("OFW_WARMKEY", key, 1);
+				execvp(main_argv[0], main_argv);
+				unsetenv("OFW_WARMSTART");
+				unsetenv("OFW_WARMKEY");
+			}
+		}
+		fclose(manifest);
+	}
+	warm_mark = log_count();
+#else
+	UNUSED_ARGUMENT(prefix);
+	UNUSED_ARGUMENT(dir);
+#endif
+	return (0);
+}
+
+INTERNAL long
+w_save(char *path)
+{
+#ifdef WARM_START
+	if (warm_mark < 0)
+		return (-1);
+	sprintf(path, "%s.%d.dic", warm_path, (int)getpid());
+	warm_saving = 1;
+	return (0);
+#else
+	UNUSED_ARGUMENT(path);
+	return (-1);
+#endif
+}
+
+INTERNAL long
+w_saved(long ok)
+{
+#ifdef WARM_START
+	char tmpname[MAXPATHLEN+20], path[MAXPATHLEN+4];
+	FILE *manifest;
+
+	warm_saving = 0;
+	if (warm_mark < 0)
+		return (-1);
+
+	/*
+	 * Both files are written under temporary names and renamed into
+	 * place, dictionary first, so that concurrent builds never see a
+	 * partial snapshot.
+	 */
+	sprintf(tmpname, "%s.%d.dic", warm_path, (int)getpid());
+	sprintf(path, "%s.dic", warm_path);
+	if (!ok || rename(tmpname, path) != 0) {
+		(void)unlink(tmpname);
+		warm_mark = -1;
+		return (-1);
+	}
+	sprintf(tmpname, "%s.%d", warm_path, (int)getpid());
+	sprintf(path, "%s.snp", warm_path);
+	if ((manifest = fopen(tmpname, "w")) == NULL)
+		return (-1);
+	log_manifest(manifest, warm_mark);
+	warm_mark = -1;
+	if (fclose(manifest) != 0 || rename(tmpname, path) != 0) {
+		(void)unlink(tmpname);
+		return (-1);
+	}
+	return (0);
+#else
+	UNUSED_ARGUMENT(ok);
+	return (-1);
+#endif
+}
+
 INTERNAL long
 f_read(long fd, char *buf, long cnt)
 {
@@ -2034,6 +2410,53 @@ s_system(char *str)
 	return ((long)i);
 }
 
+/*
+ * s_spawn() and s_wait() let the builder run the rebuild commands of
+ * independent targets concurrently.  They are the asynchronous halves
+ * of s_system(), so they are only available where fork() is.
+ */
+int wait_status;
+
+INTERNAL long
+s_spawn(char *str)
+{
+#if defined(__unix__) && !defined(USE_STDIO)
+	char *cmd;
+	pid_t pid;
+
+	fflush(stdout);
+	cmd = expand_name(str);
+	if ((pid = fork()) == 0) {
+		execl("/bin/sh", "sh", "-c", cmd, (char *)0);
+		_exit(127);
+	}
+	return ((long)pid);
+#else
+	UNUSED_ARGUMENT(str);
+	return (-1L);
+#endif
+}
+
+INTERNAL long
+s_wait(void)
+{
+#if defined(__unix__) && !defined(USE_STDIO)
+	pid_t pid;
+
+	while ((pid = waitpid((pid_t)-1, &wait_status, 0)) < 0 && errno == EINTR)
+		;
+	return ((long)pid);
+#else
+	return (-1L);
+#endif
+}
+
+INTERNAL long
+s_status(void)
+{
+	return ((long)wait_status);
+}
+
 /*
  * DOS doesn't allow trailing backslashes in directory name
  * arguments to system calls.  This function removes them.
@@ -2296,7 +2719,7 @@ m_deflate(long outlen, long outadr, long inlen, long inadr)
 	unsigned char gzip_hdr[] = {
 		0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03
 	};
-	unsigned long crc = crc32(0, inadr, inlen);
+	unsigned long crc = crc32_fast(0, inadr, inlen);
 	int err = compress(outbuf, &outlen, (void *)inadr, inlen);
 	if (err) return 0;
 
@@ -2319,6 +2742,27 @@ m_deflate(long outlen, long outadr, long inlen, long inadr)
 	return (18 + datalen);
 }
 
+INTERNAL long
+m_lz4(long outlen, long outadr, long inlen, long inadr)
+{
+	return ((long)lz4_compress((void *)inadr, inlen, (void *)outadr, outlen));
+}
+
+INTERNAL long
+m_pdeflate(long nthreads, long outlen, long outadr, long inlen, long inadr)
+{
+	return ((long)pdeflate((void *)inadr, inlen, (void *)outadr, outlen,
+			       (int)nthreads));
+}
+
+INTERNAL long
+m_crc32(long len, long adr, long crc)
+{
+	/* crc32_fast() conditions the CRC before and after; ($crc) doesn't */
+	return ((long)(crc32_fast(~crc & 0xffffffff, (void *)adr, len)
+		       ^ 0xffffffff));
+}
+
 INTERNAL long
 m_inflate(long nohdr, long outadr, long inadr)
 {
@@ -2326,6 +2770,12 @@ m_inflate(long nohdr, long outadr, long inadr)
 	return((long)inflate(workspace, nohdr, (void *)outadr, (void *)inadr));
 }
 
+INTERNAL long
+m_inflate_stream(long op, long zsadr, long wsadr)
+{
+	return((long)inflate((void *)wsadr, (int)op, (void *)0, (void *)zsadr));
+}
+
 INTERNAL long
 m_map(long fd, long len, long off)
 {
@@ -14,6 +14,9 @@
  *   windows
  * * Access global variables relative to a base variable, for position
  *   independence.
+ * * The huft linked tables were replaced by flat tables of 32-bit entries,
+ *   with literal pairs decoded by a single lookup, a word-wide bit buffer,
+ *   and word-at-a-time match copies where unaligned access is cheap.
  *
  * ROM
  * The assumption is that a compressed ROM is composed of three
@@ -58,6 +61,9 @@
  *    pointer, e.g.  foo = (u_short)*(volatile u_long *)p, which causes the
  *    compiler to access the datum in its "natural" size, and then demote
  *    the datum to the smaller size.
+ *
+ *    The decoding tables are now arrays of 32-bit words that are only
+ *    ever accessed at that size, which avoids both cases.
  */
 #endif
 
@@ -71,14 +77,103 @@
  */
 
 #define u_long  unsigned long
+#define u_int   unsigned int
 #define u_short unsigned short
 #define u_char  unsigned char
 #define NULL    (void *)0
 
-static void init_var();
-static u_long NEEDBITS();
-static int huft_fixed();
-static int huft_dynamic();
+/*
+ * The bit buffer is a native word: 64 bits on 64-bit hosts, 32 bits on
+ * the 32-bit firmware targets, so no multi-word shifts (and therefore no
+ * libgcc helpers) are needed in the freestanding build.
+ */
+#define BB_BITS		(8 * (int)sizeof(u_long))
+
+/*
+ * Where unaligned little-endian word loads are cheap, refill the bit
+ * buffer and copy matches a word at a time.  Elsewhere use bytes.
+ */
+#if (defined(__i386__) || defined(__x86_64__) || defined(__aarch64__)) \
+    && !defined(BI_ENDIAN) && !defined(__BIG_ENDIAN__) && !defined(__AARCH64EB__)
+#define UNALIGNED_OK
+typedef u_long __attribute__((__may_alias__, __aligned__(1))) u_word;
+#define LOADW(p)	(*(u_word *)(p))
+#define STOREW(p, v)	(*(u_word *)(p) = (v))
+#endif
+
+struct bits {
+	u_long	b;		/* bit buffer */
+	int	k;		/* number of valid bits in b */
+	u_char	*in;		/* next input byte */
+};
+
+struct workspace;
+
+static void init_var(u_char *, struct workspace *);
+static int fixed_tables(struct workspace *);
+static int dynamic_tables(struct bits *, struct workspace *);
+static u_char *inflate_codes(struct bits *, u_char *, u_char *,
+			     u_int *, u_int *);
+static inline u_char *decode_codes(struct bits *, u_char *, u_char *,
+				   u_int *, u_int *, u_char *, u_char *, int *)
+	__attribute__((always_inline));
+static u_long compute_crc();
+static void makecrc(u_int *);
+static u_long update_crc(u_long, u_char *, u_long, u_int *);
+
+/*
+ * Streaming interface.  inflate() with one of these negative values
+ * for nohdr works on a stream that arrives, and is handed back, a
+ * piece at a time, instead of on a whole image in memory.  compr then
+ * points to a struct zstream and clear is unused.  The workspace must
+ * be ZS_WS_LEN bytes and must be kept for the life of the stream.
+ *
+ * ZS_INIT (gzip) or ZS_INIT_RAW (bare deflate data, as in zip files)
+ * starts a stream.  ZS_RUN then consumes as much of the input at
+ * next_in as it can, and puts as much output at next_out as fits,
+ * advancing both and reducing the avail counts.  It returns ZS_MORE
+ * when it needs more input or more room for output, ZS_END when all
+ * of the output has been delivered and the gzip trailer checked, or
+ * a negative number for bad data.  ZS_FINISH is ZS_RUN that also says
+ * there is no input beyond this, so a short stream is an error.  Input
+ * is taken into the workspace as it arrives, so any bytes following
+ * the end of the stream are swallowed.
+ *
+ * ZS_QUERY returns ZS_WS_LEN and touches nothing, so callers can tell
+ * whether a loaded module has the stream ops.  Older modules read any
+ * nonzero nohdr as bare deflate data at compr, so the caller points
+ * compr and clear at an empty final stored block, which those modules
+ * expand to 0 bytes.
+ *
+ * The streaming decoder nearly doubles the size of the module, so
+ * freestanding builds that need only the one-shot decoder can leave it
+ * out with -DNO_INFLATE_STREAM.  All of the stream ops, ZS_QUERY
+ * included, then return ZS_BAD.
+ */
+struct zstream {
+	u_char	*next_in;	/* next input byte */
+	u_long	avail_in;	/* bytes at next_in */
+	u_char	*next_out;	/* where the next output byte goes */
+	u_long	avail_out;	/* room at next_out */
+};
+
+#define	ZS_INIT		-2
+#define	ZS_INIT_RAW	-3
+#define	ZS_RUN		-4
+#define	ZS_FINISH	-5
+#define	ZS_QUERY	-6
+
+#define	ZS_MORE		0
+#define	ZS_END		1
+#define	ZS_BAD		-1	/* bad data or CRC */
+#define	ZS_BADSIZE	-2	/* length does not match the trailer */
+#define	ZS_SHORT	-3	/* input ended in the middle of the stream */
+
+#define	ZS_WS_LEN	0x18000
+
+#ifndef NO_INFLATE_STREAM
+static int inflate_stream(struct workspace *, int, struct zstream *);
+#endif
 
 #define FILENAME_PRESENT    0x08 /* flag byte bit meaning filename follows */
 
@@ -95,65 +190,135 @@ static int huft_dynamic();
  * possible to run the inflate module from any memory location.
  */
 
-/* The extra 256 are for the CRC table */
-#define	WS_NGLOBALS	32+256
+/* The rest are for the CRC tables, 8 x 256 32-bit entries */
+#define	CRC_NGLOBALS	(8 * 256 * 4 / sizeof(u_long))
+#define	WS_NGLOBALS	(32 + CRC_NGLOBALS)
 struct workspace {
 	u_long	globals[WS_NGLOBALS];
 	u_char	*heap;
 };
 
-#define	bb		0
-#define	bk		1
-#define	codeptr		2
-#define	border		3
-#define	cplens		4
-#define	cplext		5
-#define	cpdist		6
-#define	cpdext		7
-#define huft_base	8
+#define	border		0	/* order of the code length code lengths */
+#define	lbase		1	/* length base values, by symbol - 257 */
+#define	lext		2	/* length extra bits */
+#define	dbase		3	/* distance base values */
+#define	dext		4	/* distance extra bits */
+#define	ltab		5	/* dynamic literal/length table */
+#define	dtab		6	/* dynamic distance table */
+#define	ctab		7	/* code length code table */
+#define	fltab		8	/* fixed literal/length table */
+#define	fdtab		9	/* fixed distance table */
+#define	fixed_ok	10	/* fixed tables have been built */
+/* streaming state; see inflate_stream() */
+#define	zstate		11	/* what comes next in the input */
+#define	zgzip		12	/* stream has a gzip header and trailer */
+#define	zb		13	/* bit buffer */
+#define	zk		14	/* bits in bit buffer */
+#define	zleft		15	/* bytes left in a stored block */
+#define	zlast		16	/* current block is the last one */
+#define	zbtype		17	/* current block type */
+#define	zwin		18	/* output window */
+#define	zwp		19	/* end of decoded output in window */
+#define	zrp		20	/* end of output handed to the caller */
+#define	zibuf		21	/* input buffer */
+#define	zilen		22	/* bytes in input buffer */
+#define	zipos		23	/* bytes of input buffer consumed */
+#define	zcrc		24	/* running CRC of the output */
+#define	ztotal		25	/* output length, mod 2^32 */
 #define	space		31
-#define	crctab		32	/* 256 longs starting here */
+#define	crctab		32	/* CRC tables starting here */
 
 #define	VAR(x)	(workspace->globals[x])
 #define	ws	workspace
 #define WORKSPACE struct workspace *ws
 
-#define HUFT_FREE  VAR(space) = VAR(huft_base)
-
 #define	ALLOC(v, s) {				\
 			VAR(v) = VAR(space);	\
 			VAR(space) += (s);	\
 		    }
 
-#define NEXTBYTE  (*(u_char *)(VAR(codeptr))++)
+#define	TABLE(v)	((u_int *)VAR(v))
 
-#define MASK_BITS(n)	((1 << (n)) - 1)
+#define MASK_BITS(n)	((1UL << (n)) - 1)
 
 #define WSIZE 0x8000     /* window size--must be a power of two, and */
                          /*  at least 32K for zip's deflate method */
 
-#define DUMPBITS(n) {b>>=(n);VAR(bk)-=(n);}
+/*
+ * Decoding tables
+ *
+ * The literal/length and distance codes are decoded with one lookup in
+ * a root table indexed by the next LBITS (DBITS) bits of input.  Codes
+ * longer than that take a second lookup in a subtable.  Every entry is
+ * one 32-bit word, accessed only at that size:
+ *
+ *	bits  0..4	number of input bits the entry consumes
+ *	bits  5..7	entry kind
+ *	bits  8..15	literal, number of extra bits, or subtable index bits
+ *	bits 16..31	second literal, base value, or subtable offset
+ *
+ * A literal/length root entry whose code is short enough that the next
+ * code also fits in the lookup bits is rewritten as a K_LIT2 entry
+ * that emits both literals at once; most literals in text and code are
+ * 8 bits or less, so this roughly halves the lookups for literal runs.
+ */
+#define	MAXBITS		15	/* longest code in a deflate stream */
+#define	LBITS		10	/* literal/length root table bits */
+#define	DBITS		8	/* distance root table bits */
+#define	CBITS		7	/* code length code table bits */
+
+#define	LSIZE		2048	/* entries: root plus worst-case subtables */
+#define	DSIZE		1024
+#define	CSIZE		(1 << CBITS)
+
+#define	K_LIT		0
+#define	K_LIT2		1
+#define	K_LEN		2	/* length or distance: base and extra bits */
+#define	K_EOB		3
+#define	K_SUB		4
+#define	K_BAD		5
+
+#define	ENT(k, n, a, v)	((n) | ((k) << 5) | ((a) << 8) | ((u_int)(v) << 16))
+#define	E_BITS(e)	((e) & 0x1f)
+#define	E_KIND(e)	(((e) >> 5) & 7)
+#define	E_A(e)		(((e) >> 8) & 0xff)
+#define	E_V(e)		((e) >> 16)
+
+#define	NOSYM		99	/* extra bits value for an invalid symbol */
 
-#ifdef BI_ENDIAN
-#define E 0
-#define B 1
-#define N 2
-#define T sizeof(char *)
-struct huft {
-  u_char a[__alignof__(char *) + sizeof(char *)];
-};
+/*
+ * Bit buffer access.  These work on the locals b, bk, and inp, which
+ * are loaded from and stored back to a struct bits around each use.
+ */
+#define	GETBITS(s)	{ b = (s)->b; bk = (s)->k; inp = (s)->in; }
+#define	PUTBITS(s)	{ (s)->b = b; (s)->k = bk; (s)->in = inp; }
+
+#ifdef UNALIGNED_OK
+/*
+ * Load a whole word and keep as many complete bytes as fit.  The bits
+ * above bk may then hold part of the next byte, which is harmless
+ * because the next refill ORs in the same bits again.
+ */
+#define	REFILL {					\
+		b |= LOADW(inp) << bk;			\
+		inp += (BB_BITS - 1 - bk) >> 3;		\
+		bk |= BB_BITS - 8;			\
+	}
 #else
-struct huft {
-  u_char e;                /* number of extra bits or operation */
-  u_char b;                /* number of bits in this code or subcode */
-  union {
-    u_short n;             /* literal, length base, or distance base */
-    struct huft *t;        /* pointer to next level of table */
-  } v;
-};
+#define	REFILL {					\
+		do {					\
+			b |= (u_long)*inp++ << bk;	\
+			bk += 8;			\
+		} while (bk <= BB_BITS - 8);		\
+	}
 #endif
 
-static u_long compute_crc();
+#define	NEED(n)		if (bk < (n)) REFILL
+#define	BITS(n)		(b & MASK_BITS(n))
+#define	DROP(n)		{ b >>= (n); bk -= (n); }
+
+/* Discard bits to a byte boundary and give back the unused whole bytes */
+#define	BYTEALIGN	{ inp -= bk >> 3; b = 0; bk = 0; }
 
 /*
  * The inflate() entry point--leave this at the head of the file,
@@ -180,6 +345,20 @@ inflate(struct workspace *wsptr, int nohdr, u_char* clear, u_char *compr)
 	int     crc, size, stored_crc, stored_size;
         register u_char *outp = clear;
 	struct workspace *ws;
+	struct bits bs;
+	u_long b;		/* bit buffer */
+	int bk;			/* bits in bit buffer */
+	u_char *inp;		/* input pointer */
+
+	if (nohdr < -1) {
+#ifdef NO_INFLATE_STREAM
+		return (ZS_BAD);
+#else
+		if (nohdr == ZS_QUERY)
+			return (ZS_WS_LEN);
+		return (inflate_stream(wsptr, nohdr, (struct zstream *)compr));
+#endif
+	}
 
 	/* first initialize workspace */
 	ws = wsptr;
@@ -197,210 +376,67 @@ inflate(struct workspace *wsptr, int nohdr, u_char* clear, u_char *compr)
 	 * Filename:    null-terminated string or nothing, depending on flags
 	 */
 
-         if (nohdr == 0) {
-            /* strip off header */
-            for (n = 0; n < 3; ++n)
-		(void) NEXTBYTE;
-            flags = NEXTBYTE;
-            for (n = 0; n < 6; ++n)
-		(void) NEXTBYTE;
-            if (flags & FILENAME_PRESENT)
-		while (NEXTBYTE)
-                    ;
-         }
+	inp = compr;
+	if (nohdr == 0) {
+		/* strip off header */
+		flags = inp[3];
+		inp += 10;
+		if (flags & FILENAME_PRESENT)
+			while (*inp++)
+				;
+	}
+	b = 0;
+	bk = 0;
 
 	/* decompress until the last block */
 	do {
 	    u_long t;           /* block type */
-	    u_long b;                /* bit buffer */
 
-	    /* make local bit buffer */
-	    b = VAR(bb);
-
-	    /* read in last block bit */
-	    b = NEEDBITS(1, b, ws);
+	    /* read in last block bit and block type */
+	    NEED(3);
 	    done = (int)b & 1;
-	    DUMPBITS(1)
-
-	    /* read in block type */
-	    b = NEEDBITS(2, b, ws);
-	    t = (u_long)b & 3;
-	    DUMPBITS(2)
-
-	    /* restore the global bit buffer */
-	    VAR(bb) = b;
+	    t = (b >> 1) & 3;
+	    DROP(3);
 
-	    /* inflate that block type */
 	    if (t == 0) {
 		/* Block is stored without compression; copy it out */
-                {
-                  u_long n;             /* number of bytes in block */
-                  u_long b;             /* bit buffer */
-                
-                  /* make local copies of globals */
-                  b = VAR(bb);          /* initialize bit buffer */
-                
-                  /* go to byte boundary */
-                  n = VAR(bk) & 7;
-                  DUMPBITS(n);
-                
-                  /* get the length and its complement */
-                  b = NEEDBITS(16, b, ws);
-                  n = ((u_long)b & 0xffff);
-                  DUMPBITS(16)
-                  b = NEEDBITS(16, b, ws);
-                  if (n != (u_long)((~b) & 0xffff)) {
-		      /* error in compressed data */
-                      done = 1;
-		  } else {
-                      DUMPBITS(16)
-                
-                      /* read and output the compressed data */
-                      while (n--)
-                      {
-                        b = NEEDBITS(8, b, ws);
-                        *outp++ = (u_char) b;
-                        DUMPBITS(8)
-                      }
-                
-                      /* restore the globals from the locals */
-                      VAR(bb) = b;           /* restore global bit buffer */
-	           }
-                }
+		BYTEALIGN;
+		n = inp[0] | (inp[1] << 8);
+		if ((n ^ (inp[2] | (inp[3] << 8))) != 0xffff) {
+		    /* error in compressed data */
+		    return (-1);
+		}
+		inp += 4;
+		while (n--)
+		    *outp++ = *inp++;
 
 	    } else {
-	        int i = 0;            /* temporary variables */
-		struct huft *tl;      /* literal/length code table */
-		struct huft *td;      /* distance code table */
-		int bl;               /* lookup bits for tl */
-		int bd;               /* lookup bits for td */
-		u_long ll[286+30];    /* literal/length and dist. code lens */
-
-		if ( t == 1
-		     ? huft_fixed(i, &tl, &td, &bl, &bd, ll, ws)
-		     : huft_dynamic(i, &tl, &td, &bl, &bd, ll, ws) ) {
-		    done = 1;
+		u_int *tl, *td;     /* literal/length and distance tables */
+
+		PUTBITS(&bs);
+		if (t == 1) {
+		    if (fixed_tables(ws))
+			return (-1);
+		    tl = TABLE(fltab);
+		    td = TABLE(fdtab);
+		} else if (t == 2) {
+		    if (dynamic_tables(&bs, ws))
+			return (-1);
+		    tl = TABLE(ltab);
+		    td = TABLE(dtab);
 		} else {
-
-		    /*
-		     * decompress the codes in a deflated (compressed)
-		     * block until an end-of-block code
-		     */
-                    {
-                      register u_long e; /* table entry flag/# of extra bits */
-                      u_long n, d;       /* length and index for copy */
-                      struct huft *t;    /* pointer to table entry */
-                      u_long ml, md;     /* masks for bl and bd bits */
-                      u_long b;          /* bit buffer */
-                    
-                      /* make local copies of globals */
-                      b = VAR(bb);            /* initialize bit buffer */
-                    
-                      /* inflate the coded data */
-                      ml = MASK_BITS(bl);     /* precompute masks for speed */
-                      md = MASK_BITS(bd);
-                      for (;;)                /* do until end of block */
-                      {
-                        b = NEEDBITS(bl, b, ws);
-#ifdef BI_ENDIAN
-                        if ((e = (t = tl + ((u_long)b & ml))->a[E]) > 16)
-#else
-                        if ((e = (t = tl + ((u_long)b & ml))->e) > 16)
-#endif
-                          do {
-                            if (e == 99)
-                              goto out;
-#ifdef BI_ENDIAN
-                            DUMPBITS(t->a[B])
-#else
-                            DUMPBITS(t->b)
-#endif
-                            e -= 16;
-                            b = NEEDBITS((int) e, b, ws);
-#ifdef BI_ENDIAN
-                          } while ((e = (t = 
-						(*(struct huft **)(&t->a[T]))
-					 	+ ((u_long)b & MASK_BITS(e))
-					)->a[E]
-				    ) > 16);
-                        DUMPBITS(t->a[B])
-#else
-                          } while ((e = (t = t->v.t +
-					 ((u_long)b & MASK_BITS(e)))->e) > 16);
-                        DUMPBITS(t->b)
-#endif
-                        if (e == 16)             /* then it's a literal */
-#ifdef BI_ENDIAN
-                           *outp++ = (u_char)*(volatile u_short *)(&t->a[N]);
-#else
-                           *outp++ = (u_char) t->v.n;
-#endif
-                        else                     /* it's an EOB or a length */
-                        {
-                          /* exit if end of block */
-                          if (e == 15)
-                            break;
-                    
-                          /* get length of block to copy */
-                          b = NEEDBITS((int) e, b, ws);
-#ifdef BI_ENDIAN
-                          n = *(u_short *)(&t->a[N]) + ((u_long)b & MASK_BITS(e));
-#else
-                          n = t->v.n + ((u_long)b & MASK_BITS(e));
-#endif
-                          DUMPBITS(e);
-                    
-                          /* decode distance of block to copy */
-                          b = NEEDBITS(bd, b, ws);
-#ifdef BI_ENDIAN
-                          if ((e = (t = td + ((u_long)b & md))->a[E]) > 16)
-#else
-                          if ((e = (t = td + ((u_long)b & md))->e) > 16)
-#endif
-                            do {
-                              if (e == 99)
-                                goto out;
-#ifdef BI_ENDIAN
-                              DUMPBITS(t->a[B])
-#else
-                              DUMPBITS(t->b)
-#endif
-                              e -= 16;
-                              b = NEEDBITS((int) e, b, ws);
-#ifdef BI_ENDIAN
-                            } while ((e = (t = *(struct huft **)(&t->a[T]) +
-					 ((u_long)b & MASK_BITS(e)))->a[E]) > 16);
-                          DUMPBITS(t->a[B])
-#else
-                            } while ((e = (t = t->v.t +  ((u_long)b & MASK_BITS(e)))->e) > 16);
-                          DUMPBITS(t->b)
-#endif
-                          b = NEEDBITS((int) e, b, ws);
-#ifdef BI_ENDIAN
-                          d = *(u_short *)(&t->a[N]) + ((u_long)b & MASK_BITS(e));
-#else
-                          d = t->v.n + ((u_long)b & MASK_BITS(e));
-#endif
-                          DUMPBITS(e)
-
-		          while (n--) {
-			      *outp = outp[-d];
-			      outp++;
-		          }
-
-                        }
-                      }
-                    
-		      /* free decoding tables */
-		      HUFT_FREE;
-
-                      /* restore the globals from the locals */
-                      VAR(bb) = b;            /* restore global bit buffer */
-	      out:   ;
-                    }
-	    	}
+		    return (-1);
+		}
+
+		/*
+		 * decompress the codes in a deflated (compressed)
+		 * block until an end-of-block code
+		 */
+		outp = inflate_codes(&bs, outp, clear, tl, td);
+		if (outp == NULL)
+		    return (-1);
+		GETBITS(&bs);
 	    }
-		
 	} while (!done);
 
 	if (nohdr != 0) {
@@ -408,23 +444,14 @@ inflate(struct workspace *wsptr, int nohdr, u_char* clear, u_char *compr)
 	}
 
         /* Check the size and CRC against the stored values*/
-	{
-	u_long b, n;
-
-        b = VAR(bb);            /* initialize bit buffer */
-
-        /* go to byte boundary */
-        n = VAR(bk) & 7;
-        DUMPBITS(n);
-
-	stored_crc = NEEDBITS(32, b, ws);
-	b = 0; VAR(bk) = 0;         // DUMPBITS(32) doesn't compile.
-	stored_size = NEEDBITS(32, b, ws);
-	b = 0; VAR(bk) = 0;         // DUMPBITS(32) doesn't compile. 
-	}
+	BYTEALIGN;
+	stored_crc = inp[0] | (inp[1] << 8) | (inp[2] << 16)
+		| ((u_long)inp[3] << 24);
+	stored_size = inp[4] | (inp[5] << 8) | (inp[6] << 16)
+		| ((u_long)inp[7] << 24);
 
 	size = outp - clear;
-	crc = compute_crc(clear, size, (u_long *)&VAR(crctab));
+	crc = compute_crc(clear, size, (u_int *)&VAR(crctab));
 
         if (size != stored_size)
 	     return (-2);
@@ -434,510 +461,802 @@ inflate(struct workspace *wsptr, int nohdr, u_char* clear, u_char *compr)
 	return ((u_long)(size));
 }
 
+#ifndef NO_INFLATE_STREAM
+/*
+ * Streaming decoder
+ *
+ * Output is decoded into a window of twice the deflate window size in
+ * the workspace, and handed to the caller from there.  Once the window
+ * fills and has been drained, its last WSIZE bytes are moved to the
+ * front, which is all the history that matches can refer to.
+ *
+ * Input is collected in a buffer in the workspace.  Rather than being
+ * able to stop at any bit, the decoder only stops between codes, block
+ * headers, and so on.  When one of those turns out to run past the
+ * input it has, it backs up to where it started and waits for more.
+ * A dynamic block header can be read well past the end of the input
+ * before that is noticed, hence the slack after the buffer.
+ */
+#define	ZWIN		(2 * WSIZE)
+#define	ZMAXOUT		258		/* most output from one code */
+#define	ZIBUF		0x1000
+#define	ZISLACK		0x400
+
+/* Decoder states */
+#define	ZS_HEADER	0
+#define	ZS_BLOCK	1
+#define	ZS_STORED	2
+#define	ZS_CODES	3
+#define	ZS_TRAILER	4
+#define	ZS_DONE		5
+
+/* Reasons for zs_step() to stop, besides errors */
+#define	ZS_NEED_IN	0
+#define	ZS_NEED_OUT	1
+
+/* Has s consumed bits past the end of the input that is really there? */
+#define	OVERRUN(s, iend)	((long)((s)->in - (iend)) * 8 > (s)->k)
+
+/*
+ * Make the bit position in s the new starting point.  Whole bytes in
+ * the bit buffer are given back, since they may have been read from
+ * past the end of the input and so need reading again.
+ */
+#define	ZS_SAVE(s) {						\
+		VAR(zk) = (s)->k & 7;				\
+		VAR(zb) = (s)->b & MASK_BITS(VAR(zk));		\
+		VAR(zipos) = (s)->in - ((s)->k >> 3)		\
+			- (u_char *)VAR(zibuf);			\
+	}
+
+/* Account for output decoded up to outp */
 static void
-init_var(compr, ws)
-u_char *compr;
-WORKSPACE;
+zs_output(WORKSPACE, u_char *outp)
 {
-	u_long *ulp;
-	u_short *usp, us;
-	int i;
+	u_char *wp = (u_char *)VAR(zwp);
 
-	/* initialize variables */
-	VAR(bb) = 0;
-	VAR(bk) = 0;
-	VAR(codeptr) = (u_long) compr;
+	VAR(zcrc) = update_crc(VAR(zcrc), wp, outp - wp,
+			       (u_int *)&VAR(crctab));
+	VAR(ztotal) += outp - wp;
+	VAR(zwp) = (u_long)outp;
+}
 
-	/* Tables for deflate from PKZIP's appnote.txt. */
-	/* Order of the bit length code lengths */
-	ALLOC(border, 19 * sizeof(u_long));
-	ulp = (u_long *) VAR(border);
-	*ulp++ = 16; *ulp++ = 17; *ulp++ = 18; *ulp++ = 0;
-	*ulp++ =  8; *ulp++ =  7; *ulp++ =  9; *ulp++ = 6;
-	*ulp++ = 10; *ulp++ =  5; *ulp++ = 11; *ulp++ = 4;
-	*ulp++ = 12; *ulp++ =  3; *ulp++ = 13; *ulp++ = 2;
-	*ulp++ = 14; *ulp++ =  1; *ulp++ = 15;
-
-	/* Copy lengths for literal codes 257..285 */
-	ALLOC(cplens, 16 * sizeof(u_long));
-	usp = (u_short *) VAR(cplens);
-        *usp++ =   3; *usp++ =   4; *usp++ =   5; *usp++ =   6; *usp++ =   7;
-	*usp++ =   8; *usp++ =   9; *usp++ =  10; *usp++ =  11; *usp++ =  13;
-	*usp++ =  15; *usp++ =  17; *usp++ =  19; *usp++ =  23; *usp++ =  27;
-	*usp++ =  31; *usp++ =  35; *usp++ =  43; *usp++ =  51; *usp++ =  59;
-	*usp++ =  67; *usp++ =  83; *usp++ =  99; *usp++ = 115; *usp++ = 131;
-	*usp++ = 163; *usp++ = 195; *usp++ = 227; *usp++ = 258; *usp++ =   0;
-	*usp++ =   0;
-        /* note: see note #13 above about the 258 in this list. */
-
-	/* Extra bits for literal codes 257..285 */
-	ALLOC(cplext, 16 * sizeof(u_long));
-	usp = (u_short *) VAR(cplext);
-	for (i = 0; i < 4; ++i)
-		*usp++ = 0;
-	for ( ; i < 28; i += 4) {
-		us = (i - 1) / 4;
-		*usp++ = us; *usp++ = us; *usp++ = us; *usp++ = us;
+/* Skip the gzip header, if all of it is here; return the next byte */
+static u_char *
+zs_header(u_char *p, u_char *iend, int *errp)
+{
+	int flags;
+	u_long n;
+
+	*errp = 0;
+	if (iend - p < 10)
+		return (NULL);
+	if (p[0] != 0x1f || p[1] != 0x8b || p[2] != 8) {
+		*errp = 1;
+		return (NULL);
+	}
+	flags = p[3];
+	p += 10;
+	if (flags & 0x04) {             /* extra field */
+		if (iend - p < 2)
+			return (NULL);
+		n = p[0] | (p[1] << 8);
+		if ((u_long)(iend - p) < n + 2)
+			return (NULL);
+		p += n + 2;
 	}
-	*usp++ = 0; *usp++ = 99; *usp++ = 99; /* 99==invalid */
-
-	/* Copy offsets for distance codes 0..29 */
-	ALLOC(cpdist, 16 * sizeof(u_long));
-	usp = (u_short *) VAR(cpdist);
-        *usp++ =     1; *usp++ =     2; *usp++ =     3; *usp++ =     4;
-	*usp++ =     5; *usp++ =     7; *usp++ =     9; *usp++ =    13;
-	*usp++ =    17; *usp++ =    25; *usp++ =    33; *usp++ =    49;
-	*usp++ =    65; *usp++ =    97; *usp++ =   129; *usp++ =   193;
-	*usp++ =   257; *usp++ =   385; *usp++ =   513; *usp++ =   769;
-	*usp++ =  1025; *usp++ =  1537; *usp++ =  2049; *usp++ =  3073;
-	*usp++ =  4097; *usp++ =  6145; *usp++ =  8193; *usp++ = 12289;
-	*usp++ = 16385; *usp++ = 24577;
-
-	/* Extra bits for distance codes */
-	ALLOC(cpdext, 16 * sizeof(u_long));
-	usp = (u_short *) VAR(cpdext);
-	*usp++ = 0; *usp++ = 0;
-	for (i = 2; i < 30; i += 2) {
-		us = (i - 1) / 2;
-		*usp++ = us; *usp++ = us;
+	if (flags & FILENAME_PRESENT) {
+		while (p < iend && *p)
+			p++;
+		if (p++ == iend)
+			return (NULL);
 	}
-	VAR(huft_base) = VAR(space);
+	if (flags & 0x10) {             /* comment */
+		while (p < iend && *p)
+			p++;
+		if (p++ == iend)
+			return (NULL);
+	}
+	if (flags & 0x02) {             /* header CRC */
+		if (iend - p < 2)
+			return (NULL);
+		p += 2;
+	}
+	return (p);
 }
 
-static u_long
-NEEDBITS(n, b, ws)
-int n;
-u_long b;
-WORKSPACE;
+/*
+ * Decode as far as the input in the buffer and the room in the window
+ * allow.  final says that no more input is coming.  Returns the reason
+ * for stopping, ZS_NEED_IN or ZS_NEED_OUT, or an error.
+ */
+static int
+zs_step(WORKSPACE, int final)
 {
-	while (VAR(bk) < (n)) {
-		b |= ((u_long)NEXTBYTE) << VAR(bk);
-		VAR(bk) += 8;
+	struct bits bs;
+	u_long b;
+	int bk;
+	u_char *inp, *iend, *ilimit, *outp, *olimit, *win;
+	u_int *tl, *td;
+	u_long n, t;
+	int eob, err, state, near;
+
+	iend = (u_char *)VAR(zibuf) + VAR(zilen);
+	win = (u_char *)VAR(zwin);
+	olimit = win + ZWIN - ZMAXOUT;
+	for (;;) {
+		bs.b = VAR(zb);
+		bs.k = VAR(zk);
+		bs.in = (u_char *)VAR(zibuf) + VAR(zipos);
+
+		/*
+		 * This is an if chain rather than a switch, which could
+		 * become a jump table outside the text section.
+		 */
+		state = VAR(zstate);
+		if (state == ZS_HEADER) {
+			if (VAR(zgzip)) {
+				bs.in = zs_header(bs.in, iend, &err);
+				if (err)
+					return (ZS_BAD);
+				if (bs.in == NULL)
+					goto need_in;
+				ZS_SAVE(&bs);
+			}
+			VAR(zstate) = ZS_BLOCK;
+			continue;
+		}
+
+		if (state == ZS_BLOCK) {
+			GETBITS(&bs);
+			NEED(3);
+			VAR(zlast) = b & 1;
+			t = (b >> 1) & 3;
+			DROP(3);
+			PUTBITS(&bs);
+			if (OVERRUN(&bs, iend))
+				goto need_in;
+			if (t == 0) {
+				BYTEALIGN;
+				if (inp + 4 > iend)
+					goto need_in;
+				n = inp[0] | (inp[1] << 8);
+				if ((n ^ (inp[2] | (inp[3] << 8))) != 0xffff)
+					return (ZS_BAD);
+				inp += 4;
+				PUTBITS(&bs);
+				VAR(zleft) = n;
+				VAR(zstate) = ZS_STORED;
+			} else if (t == 1) {
+				if (fixed_tables(ws))
+					return (ZS_BAD);
+				VAR(zstate) = ZS_CODES;
+			} else if (t == 2) {
+				err = dynamic_tables(&bs, ws);
+				if (OVERRUN(&bs, iend))
+					goto need_in;
+				if (err)
+					return (ZS_BAD);
+				VAR(zstate) = ZS_CODES;
+			} else {
+				return (ZS_BAD);
+			}
+			VAR(zbtype) = t;
+			ZS_SAVE(&bs);
+			continue;
+		}
+
+		if (state == ZS_STORED) {
+			/* the bit buffer is empty here */
+			outp = (u_char *)VAR(zwp);
+			n = VAR(zleft);
+			if (n > (u_long)(iend - bs.in))
+				n = iend - bs.in;
+			if (n > (u_long)(win + ZWIN - outp))
+				n = win + ZWIN - outp;
+			VAR(zleft) -= n;
+			while (n--)
+				*outp++ = *bs.in++;
+			zs_output(ws, outp);
+			ZS_SAVE(&bs);
+			if (VAR(zleft) != 0) {
+				if (bs.in == iend)
+					goto need_in;
+				return (ZS_NEED_OUT);
+			}
+			VAR(zstate) = VAR(zlast) ? ZS_TRAILER : ZS_BLOCK;
+			continue;
+		}
+
+		if (state == ZS_CODES) {
+			if (VAR(zbtype) == 1) {
+				tl = TABLE(fltab);
+				td = TABLE(fdtab);
+			} else {
+				tl = TABLE(ltab);
+				td = TABLE(dtab);
+			}
+			outp = (u_char *)VAR(zwp);
+			if (outp > olimit)
+				return (ZS_NEED_OUT);
+			/*
+			 * Any one code fits in 16 bytes of input.  Nearer
+			 * the end, stop once more input is read.  There is
+			 * only one call, since each one is a copy of the
+			 * whole decoder.
+			 */
+			near = iend - bs.in < 16;
+			ilimit = near ? bs.in : iend - 16;
+			outp = decode_codes(&bs, outp, win, tl, td,
+					    olimit, ilimit, &eob);
+			if (near && OVERRUN(&bs, iend))
+				goto need_in;
+			if (outp == NULL)
+				return (ZS_BAD);
+			zs_output(ws, outp);
+			ZS_SAVE(&bs);
+			if (eob)
+				VAR(zstate) = VAR(zlast) ? ZS_TRAILER : ZS_BLOCK;
+			continue;
+		}
+
+		if (state == ZS_TRAILER) {
+			if (VAR(zgzip)) {
+				GETBITS(&bs);
+				BYTEALIGN;
+				if (inp + 8 > iend)
+					goto need_in;
+				t = inp[0] | (inp[1] << 8) | (inp[2] << 16)
+					| ((u_long)inp[3] << 24);
+				n = inp[4] | (inp[5] << 8) | (inp[6] << 16)
+					| ((u_long)inp[7] << 24);
+				inp += 8;
+				PUTBITS(&bs);
+				ZS_SAVE(&bs);
+				if (((VAR(zcrc) ^ t) & 0xffffffff) != 0)
+					return (ZS_BAD);
+				if (((VAR(ztotal) ^ n) & 0xffffffff) != 0)
+					return (ZS_BADSIZE);
+			}
+			VAR(zstate) = ZS_DONE;
+		}
+		return (ZS_NEED_OUT);           /* ZS_DONE */
+
+	need_in:
+		/* the saved position is still the start of this piece */
+		return (final ? ZS_SHORT : ZS_NEED_IN);
 	}
-	return (b);
 }
 
-/* If BMAX needs to be larger than 16, then h and x[] should be u_long. */
-#define BMAX 16         /* maximum bit length of any code (16 for explode) */
-#define N_MAX 288       /* maximum number of codes in any set */
-
-#define lbits  9;          /* bits in base literal/length lookup table */
-#define dbits  6;          /* bits in base distance lookup table */
-
-#ifdef BI_ENDIAN
-static
-memcpy(dst,src,len)
-char *dst, *src;
-int len;
+static int
+inflate_stream(struct workspace *wsptr, int op, struct zstream *zs)
 {
-	while (len--)
-		*dst++ = *src++;
+	struct workspace *ws = wsptr;
+	u_char *win, *ibuf, *wp, *rp;
+	u_long n;
+	int r;
+
+	if (op == ZS_INIT || op == ZS_INIT_RAW) {
+		VAR(space) = (u_long) &ws->heap;
+		init_var(NULL, ws);
+		makecrc((u_int *)&VAR(crctab));
+		ALLOC(zwin, ZWIN);
+		ALLOC(zibuf, ZIBUF + ZISLACK);
+		if (VAR(space) > (u_long)ws + ZS_WS_LEN)
+			return (ZS_BAD);
+		VAR(zstate) = ZS_HEADER;
+		VAR(zgzip) = (op == ZS_INIT);
+		VAR(zb) = 0;
+		VAR(zk) = 0;
+		VAR(zwp) = VAR(zrp) = VAR(zwin);
+		VAR(zilen) = 0;
+		VAR(zipos) = 0;
+		VAR(zcrc) = 0;
+		VAR(ztotal) = 0;
+		return (ZS_MORE);
+	}
+
+	win = (u_char *)VAR(zwin);
+	ibuf = (u_char *)VAR(zibuf);
+	for (;;) {
+		/* hand over what has been decoded */
+		wp = (u_char *)VAR(zwp);
+		rp = (u_char *)VAR(zrp);
+		n = wp - rp;
+		if (n > zs->avail_out)
+			n = zs->avail_out;
+		zs->avail_out -= n;
+		while (n--)
+			*zs->next_out++ = *rp++;
+		VAR(zrp) = (u_long)rp;
+		if (rp != wp)
+			return (ZS_MORE);
+		if (VAR(zstate) == ZS_DONE)
+			return (ZS_END);
+
+		/* keep the last WSIZE bytes as history for matches */
+		if (wp > win + ZWIN - ZMAXOUT) {
+			for (rp = wp - WSIZE, wp = win; wp < win + WSIZE; )
+				*wp++ = *rp++;
+			VAR(zwp) = VAR(zrp) = (u_long)wp;
+		}
+
+		/* take in what input fits */
+		n = VAR(zilen) - VAR(zipos);
+		if (VAR(zipos) != 0) {
+			for (rp = ibuf + VAR(zipos), wp = ibuf; n--; )
+				*wp++ = *rp++;
+			VAR(zilen) -= VAR(zipos);
+			VAR(zipos) = 0;
+		}
+		n = ZIBUF - VAR(zilen);
+		if (n > zs->avail_in)
+			n = zs->avail_in;
+		zs->avail_in -= n;
+		for (wp = ibuf + VAR(zilen), VAR(zilen) += n; n--; )
+			*wp++ = *zs->next_in++;
+
+		r = zs_step(ws, op == ZS_FINISH && zs->avail_in == 0);
+		if (r < 0)
+			return (r);
+		if (r == ZS_NEED_IN && VAR(zwp) == VAR(zrp)) {
+			if (zs->avail_in == 0)
+				return (ZS_MORE);
+			if (VAR(zipos) == 0 && VAR(zilen) == ZIBUF)
+				return (ZS_BAD);        /* no progress */
+		}
+	}
 }
-#endif
+#endif /* NO_INFLATE_STREAM */
 
 /*
- * Given a list of code lengths and a maximum table size, make a set of
- * tables to decode that set of codes.  Return zero on success, one if
- * the given code set is incomplete (the tables are still built in this
- * case), two if the input is invalid (all zero length codes or an
- * oversubscribed set of lengths), and three if not enough memory.
+ * Decode literal/length and distance codes until end of block.
+ * Return the new output pointer, or NULL on bad data.
+ * The streaming decoder also stops before a code once outp passes
+ * olimit or the input pointer passes ilimit, and *eob says whether
+ * the block ended.  The one-shot decoder passes no limits; since this
+ * is inlined into both callers, the limit test costs it nothing.
  */
-static int
-huft_build(b, n, s, d, e, t, m, ws)
-u_long *b;            /* code lengths in bits (all assumed <= BMAX) */
-u_long n;             /* number of codes (assumed <= N_MAX) */
-u_long s;             /* number of simple-valued codes (0..s-1) */
-u_short *d;                 /* list of base values for non-simple codes */
-u_short *e;                 /* list of extra bits for non-simple codes */
-struct huft **t;        /* result: starting table */
-int *m;                 /* maximum lookup bits, returns actual */
-WORKSPACE;
+static inline u_char *
+decode_codes(struct bits *s, u_char *outp, u_char *clear, u_int *tl,
+	     u_int *td, u_char *olimit, u_char *ilimit, int *eob)
 {
-  u_long a;                   /* counter for codes of length k */
-  u_long c[BMAX+1];           /* bit length count table */
-  u_long f;                   /* i repeats in table every f entries */
-  int g;                   /* maximum code length */
-  int h;                   /* table level */
-  u_long i;                   /* counter, current code */
-  u_long j;                   /* counter */
-  int k;                   /* number of bits in current code */
-  int l;                   /* bits per table (returned in m) */
-  register u_long *p;         /* pointer into c[], b[], or v[] */
-  register struct huft *q; /* points to current table */
-  struct huft r;           /* table entry for structure assignment */
-  struct huft *u[BMAX];    /* table stack */
-  u_long v[N_MAX];            /* values in order of bit length */
-  register int w;          /* bits before this table == (l * h) */
-  u_long x[BMAX+1];           /* bit offsets, then code stack */
-  u_long *xp;                 /* pointer into x */
-  int y;                   /* number of dummy codes added */
-  u_long z;                   /* number of entries in current table */
-
-
-  /* Generate counts for each bit length */
-  for (i = 0; i < BMAX+1; ++i)
-  	c[i] = 0;
-  p = b;  i = n;
-  do {
-    c[*p]++;                    /* assume all entries <= BMAX */
-    p++;                      /* Can't combine with above line (Solaris bug) */
-  } while (--i);
-  if (c[0] == n)                /* null input--all zero length codes */
-  {
-    *t = (struct huft *)NULL;
-    *m = 0;
-    return 0;
-  }
-
-
-  /* Find minimum and maximum length, bound *m by those */
-  l = *m;
-  for (j = 1; j <= BMAX; j++)
-    if (c[j])
-      break;
-  k = j;                        /* minimum code length */
-  if ((u_long)l < j)
-    l = j;
-  for (i = BMAX; i; i--)
-    if (c[i])
-      break;
-  g = i;                        /* maximum code length */
-  if ((u_long)l > i)
-    l = i;
-  *m = l;
-
-
-  /* Adjust last length count to fill out codes, if needed */
-  for (y = 1 << j; j < i; j++, y <<= 1)
-    if ((y -= c[j]) < 0)
-      return 2;                 /* bad input: more codes than bits */
-  if ((y -= c[i]) < 0)
-    return 2;
-  c[i] += y;
-
-
-  /* Generate starting offsets into the value table for each length */
-  x[1] = j = 0;
-  p = c + 1;  xp = x + 2;
-  while (--i) {                 /* note that i == g from above */
-    *xp++ = (j += *p++);
-  }
-
-
-  /* Make a table of values in order of bit lengths */
-  p = b;  i = 0;
-  do {
-    if ((j = *p++) != 0)
-      v[x[j]++] = i;
-  } while (++i < n);
-
-
-  /* Generate the Huffman codes and for each, make the table entries */
-  x[0] = i = 0;                 /* first Huffman code is zero */
-  p = v;                        /* grab values in bit order */
-  h = -1;                       /* no tables yet--level -1 */
-  w = -l;                       /* bits decoded == (l * h) */
-  u[0] = (struct huft *)NULL;   /* just to keep compilers happy */
-  q = (struct huft *)NULL;      /* ditto */
-  z = 0;                        /* ditto */
-
-  /* go through the bit lengths (k already is bits in shortest code) */
-  for (; k <= g; k++)
-  {
-    a = c[k];
-    while (a--)
-    {
-      /* here i is the Huffman code of length k bits for value *p */
-      /* make tables up to required level */
-      while (k > w + l)
-      {
-        h++;
-        w += l;                 /* previous table always l bits */
-
-        /* compute minimum size table less than or equal to l bits */
-	z = g - w;
-        z = z > (u_long)l ? l : z;  /* upper limit on table size */
-        if ((f = 1 << (j = k - w)) > a + 1)     /* try a k-w bit table */
-        {                       /* too few codes for k-w bit table */
-          f -= a + 1;           /* deduct codes from patterns left */
-          xp = c + k;
-          while (++j < z)       /* try smaller tables up to z bits */
-          {
-            if ((f <<= 1) <= *++xp)
-              break;            /* enough codes to use up j bits */
-            f -= *xp;           /* else deduct codes from patterns */
-          }
-        }
-        z = 1 << j;             /* table entries for j-bit table */
-
-        /* allocate and link in new table */
-	q = (struct huft *)VAR(space);
-	VAR(space) += (z + 1)*sizeof(struct huft);
-
-        *t = q + 1;             /* link to list for huft_free() ?? needed ?? */
-#ifdef BI_ENDIAN
-        *(t = (struct huft **)&(q->a[T])) = (struct huft *)NULL;
-#else
-        *(t = &(q->v.t)) = (struct huft *)NULL;
+	u_long b;
+	int bk;
+	u_char *inp;
+	u_int e;
+	u_long len, dist;
+	u_char *from;
+#ifdef UNALIGNED_OK
+	u_long pat;
 #endif
-        u[h] = ++q;             /* table starts after link */
-
-        /* connect to last table, if there is one */
-        if (h)
-        {
-          x[h] = i;             /* save pattern for backing up */
-#ifdef BI_ENDIAN
-          r.a[B] = (u_char)l;         /* bits to dump before this table */
-          r.a[E] = (u_char)(16 + j);  /* bits in this table */
-          *(struct huft **)(&r.a[T]) = q;       /* pointer to this table */
-          j = i >> (w - l);     /* (get around Turbo C bug) */
-          memcpy((char *)&(u[h-1][j]), (char *)&r, sizeof(struct huft));
-#else
-          r.b = (u_char)l;         /* bits to dump before this table */
-          r.e = (u_char)(16 + j);  /* bits in this table */
-          r.v.t = q;            /* pointer to this table */
-          j = i >> (w - l);     /* (get around Turbo C bug) */
-          u[h-1][j] = r;        /* connect to last table */
-#endif
-        }
-      }
 
-      /* set up table entry in r */
-#ifdef BI_ENDIAN
-      r.a[B] = (u_char)(k - w);
-#else
-      r.b = (u_char)(k - w);
-#endif
-      if (p >= v + n)
-#ifdef BI_ENDIAN
-        r.a[E] = 99;               /* out of values--invalid code */
-#else
-        r.e = 99;               /* out of values--invalid code */
-#endif
-      else if (*p < s)
-      {
-#ifdef BI_ENDIAN
-        r.a[E] = (u_char)(*p < 256 ? 16 : 15);  /* 256 is end-of-block code */
-        *(u_short *)(&r.a[N]) = (u_short)(*(volatile u_long *)p);
-				       /* simple code is just the value */
-#else
-        r.e = (u_char)(*p < 256 ? 16 : 15);    /* 256 is end-of-block code */
-        r.v.n = (u_short)(*p);             /* simple code is just the value */
-#endif
-	p++;                           /* one compiler does not like *p++ */
-      }
-      else
-      {
-#ifdef BI_ENDIAN
-        r.a[E] = (u_char)(*(volatile u_short *)(&e[*p - s]));
-                                             /* non-simple--look up in lists */
-        *(u_short *)(&r.a[N]) = d[*p++ - s];
-#else
-        r.e = (u_char)e[*p - s];   /* non-simple--look up in lists */
-        r.v.n = d[*p++ - s];
-#endif
-      }
-
-      /* fill code-like entries with r */
-      f = 1 << (k - w);
-      for (j = i >> w; j < z; j += f)
-#ifdef BI_ENDIAN
-         memcpy((char *)&(q[j]), (char *)&r, sizeof(struct huft));
-#else
-        q[j] = r;
+	GETBITS(s);
+	*eob = 0;
+	for (;;) {
+		if (olimit != NULL && (outp > olimit || inp > ilimit)) {
+			PUTBITS(s);
+			return (outp);
+		}
+		NEED(MAXBITS);
+		e = tl[BITS(LBITS)];
+		if (E_KIND(e) == K_SUB) {
+			DROP(LBITS);
+			e = tl[E_V(e) + BITS(E_A(e))];
+		}
+		DROP(E_BITS(e));
+
+		switch (E_KIND(e)) {
+		case K_LIT2:
+			*outp++ = E_A(e);
+			*outp++ = E_V(e);
+			continue;
+		case K_LIT:
+			*outp++ = E_A(e);
+			continue;
+		case K_LEN:
+			break;
+		case K_EOB:
+			PUTBITS(s);
+			*eob = 1;
+			return (outp);
+		default:
+			PUTBITS(s);
+			return (NULL);
+		}
+
+		/* get length of block to copy */
+		NEED(5);
+		len = E_V(e) + BITS(E_A(e));
+		DROP(E_A(e));
+
+		/* decode distance of block to copy */
+		NEED(MAXBITS);
+		e = td[BITS(DBITS)];
+		if (E_KIND(e) == K_SUB) {
+			DROP(DBITS);
+			e = td[E_V(e) + BITS(E_A(e))];
+		}
+		DROP(E_BITS(e));
+		if (E_KIND(e) != K_LEN) {
+			PUTBITS(s);
+			return (NULL);
+		}
+		NEED(13);
+		dist = E_V(e) + BITS(E_A(e));
+		DROP(E_A(e));
+
+		if (dist > (u_long)(outp - clear)) {
+			PUTBITS(s);
+			return (NULL);
+		}
+		from = outp - dist;
+
+#ifdef UNALIGNED_OK
+		/*
+		 * Copy whole words when the source is at least a word
+		 * behind, so each load sees only bytes already written.
+		 */
+		if (dist >= sizeof(u_long)) {
+			while (len >= sizeof(u_long)) {
+				STOREW(outp, LOADW(from));
+				outp += sizeof(u_long);
+				from += sizeof(u_long);
+				len -= sizeof(u_long);
+			}
+		} else if (dist == 1) {
+			/* a run of one byte value, e.g. zero fill */
+			pat = (~0UL / 0xff) * *from;
+			while (len >= sizeof(u_long)) {
+				STOREW(outp, pat);
+				outp += sizeof(u_long);
+				len -= sizeof(u_long);
+			}
+			from = outp - 1;
+		}
 #endif
+		while (len--)
+			*outp++ = *from++;
+	}
+}
 
-      /* backwards increment the k-bit code i */
-      for (j = 1 << (k - 1); i & j; j >>= 1)
-        i ^= j;
-      i ^= j;
-
-      /* backup over finished tables */
-      while ((i & ((1 << w) - 1)) != x[h])
-      {
-        h--;                    /* don't need to update q */
-        w -= l;
-      }
-    }
-  }
+static u_char *
+inflate_codes(struct bits *s, u_char *outp, u_char *clear, u_int *tl,
+	      u_int *td)
+{
+	int eob;
 
-  /* Return true (1) if we were given an incomplete table */
-  return y != 0 && g != 1;
+	return (decode_codes(s, outp, clear, tl, td, NULL, NULL, &eob));
 }
 
-
-/* Create Huffman tables for an inflated type 1 (fixed Huffman codes) block. */
-static int
-huft_fixed(i, tl, td, bl, bd, ll, ws)
-  int i;                /* temporary variables */
-  struct huft **tl;     /* literal/length code table */
-  struct huft **td;     /* distance code table */
-  int *bl;              /* lookup bits for tl */
-  int *bd;              /* lookup bits for td */
-  u_long ll[286+30];    /* literal/length and distance code lengths */
+static void
+init_var(compr, ws)
+u_char *compr;
 WORKSPACE;
 {
-  /* set up literal table */
-  for (i = 0; i < 144; i++)
-    ll[i] = 8;
-  for (; i < 256; i++)
-    ll[i] = 9;
-  for (; i < 280; i++)
-    ll[i] = 7;
-  for (; i < 288; i++)          /* make a complete, but wrong code set */
-    ll[i] = 8;
-  *bl = 7;
-  if ((i = huft_build(ll, 288L, 257L, (u_short *) VAR(cplens), (u_short *) VAR(cplext), tl, bl, ws)) != 0)
-    return i;
-
-  /* set up distance table */
-  for (i = 0; i < 30; i++)      /* make an incomplete code set */
-    ll[i] = 5;
-  *bd = 5;
-  if ((i = huft_build(ll, 30L, 0L, (u_short *) VAR(cpdist), (u_short *) VAR(cpdext), td, bd, ws)) > 1)
-  {
-    return i;
-  }
-  return 0;
+	u_int *p, *q;
+	int i, n;
+
+	/* Tables for deflate from PKZIP's appnote.txt. */
+	/* Order of the bit length code lengths */
+	ALLOC(border, 19 * sizeof(u_int));
+	p = TABLE(border);
+	*p++ = 16; *p++ = 17; *p++ = 18; *p++ = 0;
+	*p++ =  8; *p++ =  7; *p++ =  9; *p++ = 6;
+	*p++ = 10; *p++ =  5; *p++ = 11; *p++ = 4;
+	*p++ = 12; *p++ =  3; *p++ = 13; *p++ = 2;
+	*p++ = 14; *p++ =  1; *p++ = 15;
+
+	/*
+	 * Copy lengths and extra bits for literal codes 257..287.
+	 * The bases follow from the extra bits, which go up by one
+	 * every four codes; 285 is the special case 258.
+	 */
+	ALLOC(lbase, 31 * sizeof(u_int));
+	ALLOC(lext, 31 * sizeof(u_int));
+	p = TABLE(lbase);
+	q = TABLE(lext);
+	for (i = 0, n = 3; i < 28; i++) {
+		q[i] = i < 8 ? 0 : (i >> 2) - 1;
+		p[i] = n;
+		n += 1 << q[i];
+	}
+	p[28] = 258; q[28] = 0;
+	p[29] = 0;   q[29] = NOSYM;
+	p[30] = 0;   q[30] = NOSYM;
+
+	/* Copy offsets and extra bits for distance codes 0..31 */
+	ALLOC(dbase, 32 * sizeof(u_int));
+	ALLOC(dext, 32 * sizeof(u_int));
+	p = TABLE(dbase);
+	q = TABLE(dext);
+	for (i = 0, n = 1; i < 30; i++) {
+		q[i] = i < 4 ? 0 : (i >> 1) - 1;
+		p[i] = n;
+		n += 1 << q[i];
+	}
+	p[30] = 0; q[30] = NOSYM;
+	p[31] = 0; q[31] = NOSYM;
+
+	ALLOC(ltab, LSIZE * sizeof(u_int));
+	ALLOC(dtab, DSIZE * sizeof(u_int));
+	ALLOC(ctab, CSIZE * sizeof(u_int));
+	ALLOC(fltab, (1 << LBITS) * sizeof(u_int));
+	ALLOC(fdtab, (1 << DBITS) * sizeof(u_int));
+	VAR(fixed_ok) = 0;
 }
 
-/*Create Huffman tables for an inflated type 2 (dynamic Huffman codes) block.*/
+/*
+ * Given a list of code lengths, build the decoding table for that code
+ * at t, with root lookup bits and at most limit entries including
+ * subtables.  Symbols below s are literals, except that symbol 256 of
+ * a literal/length code is the end-of-block code; symbols from s up
+ * decode to base[sym-s] plus ext[sym-s] extra bits.  With no base
+ * list, every symbol is a literal (the code length code).
+ * Return zero on success, one for an oversubscribed or incomplete code
+ * or not enough table space.  As in zlib, an incomplete code is only
+ * accepted for a single one-bit literal/length or distance code.
+ */
 static int
-huft_dynamic(i, tl, td, bl, bd, ll, ws)
-  int i;                /* temporary variables */
-  struct huft **tl;     /* literal/length code table */
-  struct huft **td;     /* distance code table */
-  int *bl;              /* lookup bits for tl */
-  int *bd;              /* lookup bits for td */
-  u_long ll[286+30];    /* literal/length and distance code lengths */
-WORKSPACE;
+build_table(u_int *lens, int n, int s, u_int *base, u_int *ext,
+	    u_int *t, int root, int limit, int pairs)
 {
-  u_long j;
-  u_long l;           /* last length */
-  u_long m;           /* mask for bit lengths table */
-  u_long n;           /* number of lengths to get */
-  u_long nb;          /* number of bit length codes */
-  u_long nl;          /* number of literal/length codes */
-  u_long nd;          /* number of distance codes */
-  u_long b;       /* bit buffer */
-
-  /* make local bit buffer */
-  b = VAR(bb);
-
-
-  /* read in table lengths */
-  b = NEEDBITS(5, b, ws);
-  nl = 257 + ((u_long)b & 0x1f);      /* number of literal/length codes */
-  DUMPBITS(5)
-  b = NEEDBITS(5, b, ws);
-  nd = 1 + ((u_long)b & 0x1f);        /* number of distance codes */
-  DUMPBITS(5)
-  b = NEEDBITS(4, b, ws);
-  nb = 4 + ((u_long)b & 0xf);         /* number of bit length codes */
-  DUMPBITS(4)
-  if (nl > 286 || nd > 30)
-    return 1;                   /* bad lengths */
-
-
-  /* read in bit-length-code lengths */
-  for (j = 0; j < nb; j++)
-  {
-    b = NEEDBITS(3, b, ws);
-    ll[((u_long *)VAR(border))[j]] = (u_long)b & 7;
-    DUMPBITS(3)
-  }
-  for (; j < 19; j++)
-    ll[((u_long *)VAR(border))[j]] = 0;
-
-
-  /* build decoding table for trees--single level, 7 bit lookup */
-  *bl = 7;
-  if ((i = huft_build(ll, 19L, 19L, (u_short *) NULL, (u_short *) NULL, tl, bl, ws)) != 0)
-  {
-    if (i == 1)
-    return i;                   /* incomplete code set */
-  }
-
-
-  /* read in literal and distance code lengths */
-  n = nl + nd;
-  m = MASK_BITS(*bl);
-  i = l = 0;
-  while ((u_long)i < n)
-  {
-    b = NEEDBITS(*bl, b, ws);
-#ifdef BI_ENDIAN
-    j = (*td = *tl + ((u_long)b & m))->a[B];
-    DUMPBITS(j)
-    j = *(u_short *)(&(*td)->a[N]);
-#else
-    j = (*td = *tl + ((u_long)b & m))->b;
-    DUMPBITS(j)
-    j = (*td)->v.n;
-#endif
-    if (j < 16)                 /* length of code in bits (0..15) */
-      ll[i++] = l = j;          /* save last length in l */
-    else if (j == 16)           /* repeat last length 3 to 6 times */
-    {
-      b = NEEDBITS(2, b, ws);
-      j = 3 + ((u_long)b & 3);
-      DUMPBITS(2)
-      if ((u_long)i + j > n)
-        return 1;
-      while (j--)
-        ll[i++] = l;
-    }
-    else if (j == 17)           /* 3 to 10 zero length codes */
-    {
-      b = NEEDBITS(3, b, ws);
-      j = 3 + ((u_long)b & 7);
-      DUMPBITS(3)
-      if ((u_long)i + j > n)
-        return 1;
-      while (j--)
-        ll[i++] = 0;
-      l = 0;
-    }
-    else                        /* j == 18: 11 to 138 zero length codes */
-    {
-      b = NEEDBITS(7, b, ws);
-      j = 11 + ((u_long)b & 0x7f);
-      DUMPBITS(7)
-      if ((u_long)i + j > n)
-        return 1;
-      while (j--)
-        ll[i++] = 0;
-      l = 0;
-    }
-  }
+	u_int count[MAXBITS+1];     /* number of codes of each length */
+	u_int next[MAXBITS+1];      /* next code of each length */
+	u_int code, rev, e, e2;
+	int i, j, len, max, left, used, sb;
+	u_int *sub;
+
+	for (i = 0; i <= MAXBITS; i++)
+		count[i] = 0;
+	for (i = 0; i < n; i++)
+		count[lens[i]]++;
+	for (max = MAXBITS; max > 0; max--)
+		if (count[max])
+			break;
+
+	for (i = 0; i < (1 << root); i++)
+		t[i] = ENT(K_BAD, 0, 0, 0);
+	if (max == 0)               /* no codes: any use is an error */
+		return (0);
+
+	/* check for an oversubscribed or incomplete set of lengths */
+	left = 1;
+	for (len = 1; len <= MAXBITS; len++) {
+		left <<= 1;
+		left -= count[len];
+		if (left < 0)
+			return (1);
+	}
+	if (left > 0 && (base == NULL || max != 1))
+		return (1);
+
+	/* first canonical code of each length */
+	code = 0;
+	count[0] = 0;
+	for (len = 1; len <= MAXBITS; len++) {
+		code = (code + count[len-1]) << 1;
+		next[len] = code;
+	}
 
+	/*
+	 * Size the subtables: each root slot with longer codes under it
+	 * gets enough bits for the longest of them.
+	 */
+	if (max > root) {
+		for (i = 0; i < n; i++) {
+			if ((len = lens[i]) <= root)
+				continue;
+			code = next[len]++;
+			for (rev = 0, j = 0; j < len; j++, code >>= 1)
+				rev = (rev << 1) | (code & 1);
+			e = t[rev & MASK_BITS(root)];
+			if (E_KIND(e) != K_SUB || E_A(e) < len - root)
+				t[rev & MASK_BITS(root)] =
+					ENT(K_SUB, root, len - root, 0);
+		}
+		used = 1 << root;
+		for (i = 0; i < (1 << root); i++) {
+			e = t[i];
+			if (E_KIND(e) != K_SUB)
+				continue;
+			sb = E_A(e);
+			if (used + (1 << sb) > limit)
+				return (1);
+			t[i] = ENT(K_SUB, root, sb, used);
+			for (j = 0; j < (1 << sb); j++)
+				t[used + j] = ENT(K_BAD, 0, 0, 0);
+			used += 1 << sb;
+		}
+
+		/* start over with the long codes */
+		code = 0;
+		for (len = 1; len <= MAXBITS; len++) {
+			code = (code + count[len-1]) << 1;
+			next[len] = code;
+		}
+	}
 
-  /* free decoding table for trees */
-  HUFT_FREE;
+	/* fill in the entries for each symbol, replicated as needed */
+	for (i = 0; i < n; i++) {
+		if ((len = lens[i]) == 0)
+			continue;
+		code = next[len]++;
+		for (rev = 0, j = 0; j < len; j++, code >>= 1)
+			rev = (rev << 1) | (code & 1);
+
+		if (base != NULL && i == 256 && s == 257)
+			e = ENT(K_EOB, 0, 0, 0);
+		else if (base == NULL || i < s)
+			e = ENT(K_LIT, 0, i, 0);
+		else if (ext[i - s] == NOSYM)
+			e = ENT(K_BAD, 0, 0, 0);
+		else
+			e = ENT(K_LEN, 0, ext[i - s], base[i - s]);
+
+		if (len <= root) {
+			for (j = rev; j < (1 << root); j += 1 << len)
+				t[j] = e | len;
+		} else {
+			e2 = t[rev & MASK_BITS(root)];
+			sub = t + E_V(e2);
+			sb = E_A(e2);
+			len -= root;
+			for (j = rev >> root; j < (1 << sb); j += 1 << len)
+				sub[j] = e | len;
+		}
+	}
 
+	/*
+	 * Pair up short literals.  Going down from the top means t[i >> l]
+	 * has not been rewritten yet when slot i looks at it.
+	 */
+	if (pairs) {
+		for (i = (1 << root) - 1; i >= 0; i--) {
+			e = t[i];
+			if (E_KIND(e) != K_LIT || (len = E_BITS(e)) >= root)
+				continue;
+			e2 = t[i >> len];
+			if (E_KIND(e2) != K_LIT || E_BITS(e2) > root - len)
+				continue;
+			t[i] = ENT(K_LIT2, len + E_BITS(e2), E_A(e), E_A(e2));
+		}
+	}
+	return (0);
+}
 
-  /* restore the global bit buffer */
-  VAR(bb) = b;
+/* build the tables for a block with fixed Huffman codes */
+static int
+fixed_tables(WORKSPACE)
+{
+	u_int l[288];               /* length list for build_table */
+	int i;
 
+	if (VAR(fixed_ok))
+		return (0);
+
+	for (i = 0; i < 144; i++)
+		l[i] = 8;
+	for (; i < 256; i++)
+		l[i] = 9;
+	for (; i < 280; i++)
+		l[i] = 7;
+	for (; i < 288; i++)      /* make a complete, but wrong code set */
+		l[i] = 8;
+	if (build_table(l, 288, 257, TABLE(lbase), TABLE(lext),
+			TABLE(fltab), LBITS, 1 << LBITS, 1))
+		return (1);
+
+	for (i = 0; i < 32; i++)  /* 30 and 31 decode as errors */
+		l[i] = 5;
+	if (build_table(l, 32, 0, TABLE(dbase), TABLE(dext),
+			TABLE(fdtab), DBITS, 1 << DBITS, 0))
+		return (1);
+
+	VAR(fixed_ok) = 1;
+	return (0);
+}
 
-  /* build the decoding tables for literal/length and distance codes */
-  *bl = lbits;
-  if ((i = huft_build(ll, nl, 257L, (u_short *) VAR(cplens), (u_short *) VAR(cplext), tl, bl, ws)) != 0)
-  {
-    return i;                   /* incomplete code set */
-  }
-  *bd = dbits;
-  if ((i = huft_build(ll + nl, nd, 0L, (u_short *) VAR(cpdist), (u_short *) VAR(cpdext), td, bd, ws)) != 0)
-  {
-    return i;                   /* incomplete code set */
-  }
-  return 0;
+/* read the code lengths for a dynamic block and build its tables */
+static int
+dynamic_tables(struct bits *s, WORKSPACE)
+{
+	u_long b;
+	int bk;
+	u_char *inp;
+	u_int ll[286+30];           /* literal/length and distance code lengths */
+	u_int *order, *tc;
+	u_int e;
+	int nl, nd, nb, i, j, l;
+
+	GETBITS(s);
+
+	/* read in table lengths */
+	NEED(14);
+	nl = 257 + BITS(5);         /* number of literal/length codes */
+	DROP(5);
+	nd = 1 + BITS(5);           /* number of distance codes */
+	DROP(5);
+	nb = 4 + BITS(4);           /* number of bit length codes */
+	DROP(4);
+	if (nl > 286 || nd > 30)
+		goto bad;               /* bad lengths */
+
+	/* read in bit-length-code lengths */
+	order = TABLE(border);
+	for (j = 0; j < nb; j++) {
+		NEED(3);
+		ll[order[j]] = BITS(3);
+		DROP(3);
+	}
+	for (; j < 19; j++)
+		ll[order[j]] = 0;
+
+	/* build decoding table for trees--single level, 7 bit lookup */
+	tc = TABLE(ctab);
+	if (build_table(ll, 19, 19, NULL, NULL, tc, CBITS, CSIZE, 0))
+		goto bad;
+
+	/* read in literal and distance code lengths */
+	l = 0;
+	for (i = 0; i < nl + nd; ) {
+		NEED(CBITS + 7);
+		e = tc[BITS(CBITS)];
+		if (E_KIND(e) != K_LIT)
+			goto bad;
+		DROP(E_BITS(e));
+		j = E_A(e);
+		if (j < 16) {               /* length of code in bits (0..15) */
+			ll[i++] = l = j;    /* save last length in l */
+			continue;
+		}
+		if (j == 16) {              /* repeat last length 3 to 6 times */
+			if (i == 0)
+				goto bad;
+			j = 3 + BITS(2);
+			DROP(2);
+		} else if (j == 17) {       /* 3 to 10 zero length codes */
+			j = 3 + BITS(3);
+			DROP(3);
+			l = 0;
+		} else {                    /* j == 18: 11 to 138 zero length codes */
+			j = 11 + BITS(7);
+			DROP(7);
+			l = 0;
+		}
+		if (i + j > nl + nd)
+			goto bad;
+		while (j--)
+			ll[i++] = l;
+	}
+	PUTBITS(s);
+
+	/* the end-of-block code must be present */
+	if (ll[256] == 0)
+		return (1);
+
+	/* build the decoding tables for literal/length and distance codes */
+	if (build_table(ll, nl, 257, TABLE(lbase), TABLE(lext),
+			TABLE(ltab), LBITS, LSIZE, 1))
+		return (1);
+	if (build_table(ll + nl, nd, 0, TABLE(dbase), TABLE(dext),
+			TABLE(dtab), DBITS, DSIZE, 0))
+		return (1);
+	return (0);
+
+bad:
+	/*
+	 * Leave the bit position behind, so the streaming decoder can
+	 * tell a bad header from one that it does not have all of yet.
+	 */
+	PUTBITS(s);
+	return (1);
 }
 
 #define ulg u_long
 #define uch u_char
 static void
-makecrc(u_long *crc_32_tab)
+makecrc(u_int *crc_32_tab)
 {
   /* Not copyrighted 1990 Mark Adler      */
 
@@ -982,6 +1301,20 @@ makecrc(u_long *crc_32_tab)
 	}
       crc_32_tab[i] = c;
     }
+
+  /*
+   * Seven more tables for update_crc() to take 8 bytes per step.
+   * Table k holds the CRC of a byte followed by k zero bytes.
+   */
+  for (i = 0; i < 256; i++)
+    {
+      c = crc_32_tab[i];
+      for (k = 256; k < 8 * 256; k += 256)
+	{
+	  c = crc_32_tab[c & 0xff] ^ (c >> 8);
+	  crc_32_tab[k + i] = c;
+	}
+    }
 }
 
 /* ===========================================================================
@@ -991,17 +1324,41 @@ makecrc(u_long *crc_32_tab)
 static ulg compute_crc(s, n, crc_32_tab)
     uch *s;                 /* pointer to bytes to pump through */
     unsigned n;             /* number of bytes in s[] */
-    u_long *crc_32_tab;
+    u_int *crc_32_tab;
 {
-    register ulg c;         /* temporary variable */
-
     makecrc(crc_32_tab);
-    c = 0xffffffffL;
-    if (n) do {
-        c = crc_32_tab[((int)c ^ (*s++)) & 0xff] ^ (c >> 8);
-    } while (--n);
+    return update_crc(0, s, n, crc_32_tab);
+}
+
+/*
+ * Continue the CRC c over n more bytes, with the tables from makecrc().
+ * The middle is "slice-by-8": the lookups for eight bytes are
+ * independent of each other, so they overlap instead of each waiting
+ * for the last.  The words are assembled a byte at a time, which works
+ * at any alignment and byte order, and is one load on x86.
+ */
+static ulg update_crc(c, s, n, crc_32_tab)
+    ulg c;
+    uch *s;
+    ulg n;
+    u_int *crc_32_tab;
+{
+    u_int x, hi;
+    u_int *t = crc_32_tab;
+
+    x = c ^ 0xffffffffL;
+    for (; n >= 8; n -= 8, s += 8) {
+        x ^= s[0] | (s[1] << 8) | (s[2] << 16) | ((u_int)s[3] << 24);
+        hi = s[4] | (s[5] << 8) | (s[6] << 16) | ((u_int)s[7] << 24);
+        x = t[7*256 + (x & 0xff)] ^ t[6*256 + ((x >> 8) & 0xff)]
+          ^ t[5*256 + ((x >> 16) & 0xff)] ^ t[4*256 + (x >> 24)]
+          ^ t[3*256 + (hi & 0xff)] ^ t[2*256 + ((hi >> 8) & 0xff)]
+          ^ t[256 + ((hi >> 16) & 0xff)] ^ t[hi >> 24];
+    }
+    for (; n; n--)
+        x = t[(x ^ *s++) & 0xff] ^ (x >> 8);
 
-    return c ^ 0xffffffffL;       /* (instead of ~c for 64-bit machines) */
+    return x ^ 0xffffffffL;       /* (instead of ~c for 64-bit machines) */
 }
 
 #if 0
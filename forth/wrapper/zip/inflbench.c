@@ -0,0 +1,226 @@
+/*
+ * Dropin decompression benchmark: deflate versus LZ4.
+ *
+ * Usage: inflbench [-n iterations] file ...
+ *
+ * Each file is scanned for dropin modules ("OBMD" headers) whose
+ * expanded length is nonzero, i.e. compressed dropins as written by
+ * forth/lib/mkdropin.fth.  Each deflated one is inflated the given
+ * number of times with the same inflate() entry point and 64K
+ * workspace that the firmware uses, then recompressed with LZ4 and
+ * decoded the same number of times with unlz4().  The compressed
+ * sizes and the expanded bytes per second of both are reported.
+ * Dropins that are already LZ4 are only decoded.  ROM images and
+ * individual .di files both work.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+extern int inflate();
+extern int unlz4();
+extern unsigned long lz4_compress();
+
+#define	DI_HDR_LEN	0x20
+#define	WS_LEN		0x10000
+
+static unsigned long
+be_l(unsigned char *p)
+{
+	return ((unsigned long)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+struct total {
+	double t, in, out;
+};
+
+static int
+is_gzip(unsigned char *p)
+{
+	return (p[0] == 0x1f && p[1] == 0x8b);
+}
+
+static int
+is_lz4(unsigned char *p)
+{
+	return (p[0] == 0x04 && p[1] == 0x22 && p[2] == 0x4d && p[3] == 0x18);
+}
+
+/*
+ * Decodes compr iters times, checking the length.  Returns the
+ * elapsed time, or a negative number if the data is bad.
+ */
+static double
+decode(int lz4, unsigned char *compr, unsigned char *clear,
+    unsigned long explen, unsigned char *ws, int iters)
+{
+	double t;
+	int i, n;
+
+	t = now();
+	for (i = 0; i < iters; i++) {
+		if (lz4) {
+			n = unlz4(ws, 0, clear, compr);
+		} else {
+			n = inflate(ws, 0, clear, compr);
+		}
+		if (n != explen)
+			return (-1.0);
+	}
+	return (now() - t);
+}
+
+static void
+add(struct total *tp, double t, unsigned long in, unsigned long out)
+{
+	tp->t += t;
+	tp->in += in;
+	tp->out += out;
+}
+
+static unsigned char *
+read_file(char *name, long *lenp)
+{
+	FILE *f;
+	unsigned char *buf;
+	long len;
+
+	if ((f = fopen(name, "rb")) == NULL) {
+		perror(name);
+		return (NULL);
+	}
+	fseek(f, 0L, SEEK_END);
+	len = ftell(f);
+	fseek(f, 0L, SEEK_SET);
+	/* Slack so the bit buffer refill can read past the end */
+	buf = calloc(1, len + 16);
+	if (buf == NULL || fread(buf, 1, len, f) != len) {
+		perror(name);
+		fclose(f);
+		free(buf);
+		return (NULL);
+	}
+	fclose(f);
+	*lenp = len;
+	return (buf);
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned char *image, *di, *clear, *ws, *lz;
+	unsigned long size, explen, lzlen;
+	long len, off;
+	double t, lt;
+	struct total deflate_tot = { 0 }, lz4_tot = { 0 };
+	int iters = 20;
+	int ndi = 0, ncmp = 0;
+	char name[17];
+
+	if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+		iters = atoi(argv[2]);
+		argc -= 2;
+		argv += 2;
+	}
+	if (argc < 2 || iters <= 0) {
+		fprintf(stderr, "Usage: inflbench [-n iterations] file ...\n");
+		return (2);
+	}
+
+	ws = malloc(WS_LEN);
+
+	printf("%-16s %8s %8s %10s %8s %10s\n", "dropin", "expanded",
+	    "deflate", "MB/s", "lz4", "MB/s");
+	for (; argc > 1; argc--, argv++) {
+		if ((image = read_file(argv[1], &len)) == NULL)
+			return (1);
+
+		for (off = 0; off + DI_HDR_LEN <= len; off += 4) {
+			di = image + off;
+			if (memcmp(di, "OBMD", 4) != 0)
+				continue;
+			size = be_l(di + 4);
+			explen = be_l(di + 12);
+			if (off + DI_HDR_LEN + size > len)
+				continue;
+			off += DI_HDR_LEN + ((size + 3) & ~3) - 4;
+			di += DI_HDR_LEN;
+			if (explen == 0 || !(is_gzip(di) || is_lz4(di)))
+				continue;
+
+			memcpy(name, di - DI_HDR_LEN + 16, 16);
+			name[16] = '\0';
+			clear = malloc(explen + 16);
+
+			if (is_lz4(di)) {
+				/* Already LZ4; there is nothing to compare */
+				lt = decode(1, di, clear, explen, ws, iters);
+				if (lt < 0.0)
+					goto bad;
+				printf("%-16s %8lu %8s %10s %8lu %10.1f\n", name,
+				    explen, "-", "-", size,
+				    (double)explen * iters / lt / 1e6);
+				free(clear);
+				ndi++;
+				continue;
+			}
+
+			t = decode(0, di, clear, explen, ws, iters);
+			if (t < 0.0)
+				goto bad;
+
+			lz = malloc(explen + (explen >> 22) * 4 + 24);
+			lzlen = lz4_compress(clear, explen, lz,
+			    explen + (explen >> 22) * 4 + 24);
+			lt = lzlen ? decode(1, lz, clear, explen, ws, iters) : -1.0;
+			if (lt < 0.0) {
+				fprintf(stderr, "%s: %s: LZ4 round trip failed\n",
+				    argv[1], name);
+				return (1);
+			}
+
+			printf("%-16s %8lu %8lu %10.1f %8lu %10.1f\n", name,
+			    explen, size, (double)explen * iters / t / 1e6,
+			    lzlen, (double)explen * iters / lt / 1e6);
+			add(&deflate_tot, t, size, explen);
+			add(&lz4_tot, lt, lzlen, explen);
+			ndi++;
+			ncmp++;
+			free(lz);
+			free(clear);
+			continue;
+		bad:
+			fprintf(stderr, "%s: %s: bad compressed data\n",
+			    argv[1], name);
+			return (1);
+		}
+		free(image);
+	}
+
+	if (ndi == 0) {
+		fprintf(stderr, "No compressed dropins found\n");
+		return (1);
+	}
+	if (ncmp == 0)
+		return (0);
+	printf("%d deflated dropins, %d iterations, %.0f bytes expanded\n",
+	    ncmp, iters, deflate_tot.out);
+	printf("  deflate: %8.0f bytes  %8.1f MB/s\n", deflate_tot.in,
+	    deflate_tot.out * iters / deflate_tot.t / 1e6);
+	printf("  lz4:     %8.0f bytes  %8.1f MB/s  (%+.1f%% size, %.2fx speed)\n",
+	    lz4_tot.in, lz4_tot.out * iters / lz4_tot.t / 1e6,
+	    (lz4_tot.in - deflate_tot.in) * 100.0 / deflate_tot.in,
+	    deflate_tot.t / lz4_tot.t);
+	return (0);
+}
@@ -0,0 +1,219 @@
+/*
+ * LZ4 compressor for dropin images
+ *
+ * Produces the LZ4 frame format that unlz4.c decodes and that the
+ * "lz4" command line tool reads: a frame descriptor with independent
+ * 4 MB blocks, the content size and no checksums, then the blocks,
+ * then an end mark.
+ * Blocks that do not shrink are stored.  This is a straightforward
+ * greedy compressor with one hash table entry per 4-byte sequence;
+ * dropins are compressed once at build time, so it does not need to
+ * be fast, and the decoder does not care how matches were chosen.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#define	LZ4_MAGIC	0x184d2204
+#define	BLOCK_MAX	(4 << 20)	/* BD value 7 */
+#define	MIN_MATCH	4
+#define	LAST_LITERALS	5		/* the format requires these */
+#define	MF_LIMIT	12		/* no match may start after end - 12 */
+#define	MAX_OFFSET	65535
+#define	HASH_BITS	16
+
+static unsigned long
+get32(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static void
+put32(unsigned char *p, unsigned long v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+static unsigned int
+hash4(const unsigned char *p)
+{
+	return ((get32(p) * 2654435761UL) & 0xffffffff) >> (32 - HASH_BITS);
+}
+
+/* xxHash32 of a short buffer, for the frame header checksum */
+#define	PRIME1	2654435761U
+#define	PRIME2	2246822519U
+#define	PRIME3	3266489917U
+#define	PRIME4	668265263U
+#define	PRIME5	374761393U
+#define	ROTL(x, r)	(((x) << (r)) | ((x) >> (32 - (r))))
+
+static unsigned int
+xxh32_short(const unsigned char *p, int len)
+{
+	unsigned int h = PRIME5 + len;
+
+	for (; len >= 4; len -= 4, p += 4) {
+		h += (unsigned int)get32(p) * PRIME3;
+		h = ROTL(h, 17) * PRIME4;
+	}
+	for (; len > 0; len--, p++) {
+		h += *p * PRIME5;
+		h = ROTL(h, 11) * PRIME1;
+	}
+	h ^= h >> 15;
+	h *= PRIME2;
+	h ^= h >> 13;
+	h *= PRIME3;
+	h ^= h >> 16;
+	return h;
+}
+
+static unsigned char *
+put_length(unsigned char *op, unsigned long len)
+{
+	for (; len >= 255; len -= 255)
+		*op++ = 255;
+	*op++ = len;
+	return op;
+}
+
+/*
+ * Compress one block.  Returns the compressed size, or 0 if it would
+ * not fit in outmax bytes.
+ */
+static unsigned long
+lz4_block(const unsigned char *in, unsigned long inlen,
+	  unsigned char *out, unsigned long outmax, unsigned int *table)
+{
+	const unsigned char *ip = in, *anchor = in, *ref;
+	const unsigned char *iend = in + inlen;
+	const unsigned char *mflimit = iend - MF_LIMIT;
+	const unsigned char *mlimit = iend - LAST_LITERALS;
+	unsigned char *op = out, *token;
+	unsigned char *oend = out + outmax;
+	unsigned long lit, mlen;
+	unsigned int h, prev;
+
+	/* entries are positions plus one, so zero means empty */
+	memset(table, 0, sizeof(unsigned int) << HASH_BITS);
+
+	if (inlen >= MF_LIMIT + 1) {
+		while (ip <= mflimit) {
+			h = hash4(ip);
+			prev = table[h];
+			table[h] = ip - in + 1;
+			ref = in + prev - 1;
+			if (prev == 0 || ip - ref > MAX_OFFSET
+			    || get32(ref) != get32(ip)) {
+				ip++;
+				continue;
+			}
+
+			/* extend the match forward and back */
+			mlen = MIN_MATCH;
+			while (ip + mlen < mlimit && ref[mlen] == ip[mlen])
+				mlen++;
+			while (ip > anchor && ref > in && ip[-1] == ref[-1]) {
+				ip--;
+				ref--;
+				mlen++;
+			}
+
+			lit = ip - anchor;
+			/* token, literal length, literals, offset, match length */
+			if (op + 1 + lit / 255 + 1 + lit + 2 + (mlen / 255) + 1
+			    > oend)
+				return 0;
+			token = op++;
+			*token = (lit >= 15 ? 15 : lit) << 4;
+			if (lit >= 15)
+				op = put_length(op, lit - 15);
+			memcpy(op, anchor, lit);
+			op += lit;
+			*op++ = (ip - ref);
+			*op++ = (ip - ref) >> 8;
+			mlen -= MIN_MATCH;
+			*token |= mlen >= 15 ? 15 : mlen;
+			if (mlen >= 15)
+				op = put_length(op, mlen - 15);
+
+			ip += mlen + MIN_MATCH;
+			anchor = ip;
+			/* seed the table inside the match */
+			if (ip - 2 > in && ip <= mflimit)
+				table[hash4(ip - 2)] = ip - 2 - in + 1;
+		}
+	}
+
+	/* last literals */
+	lit = iend - anchor;
+	if (op + 1 + lit / 255 + 1 + lit > oend)
+		return 0;
+	token = op++;
+	*token = (lit >= 15 ? 15 : lit) << 4;
+	if (lit >= 15)
+		op = put_length(op, lit - 15);
+	memcpy(op, anchor, lit);
+	op += lit;
+	return op - out;
+}
+
+/*
+ * Compress inlen bytes at in into an LZ4 frame at out.  Returns the
+ * frame size, or 0 if it does not fit in outmax bytes.
+ */
+unsigned long
+lz4_compress(const unsigned char *in, unsigned long inlen,
+	     unsigned char *out, unsigned long outmax)
+{
+	unsigned char *op = out;
+	unsigned char *oend = out + outmax;
+	unsigned long n, clen;
+	unsigned int *table;
+
+	if (outmax < 15 + 4)
+		return 0;
+	put32(op, LZ4_MAGIC);
+	op[4] = 0x68;           /* version 01, independent blocks, size */
+	op[5] = 0x70;           /* 4 MB blocks */
+	put32(op + 6, inlen);
+	put32(op + 10, 0);
+	op[14] = xxh32_short(op + 4, 10) >> 8;
+	op += 15;
+
+	table = malloc(sizeof(unsigned int) << HASH_BITS);
+	if (table == NULL)
+		return 0;
+
+	for (; inlen; in += n, inlen -= n) {
+		n = inlen > BLOCK_MAX ? BLOCK_MAX : inlen;
+		if (oend - op < 4) {
+			free(table);
+			return 0;
+		}
+		clen = lz4_block(in, n, op + 4, oend - op - 4, table);
+		if (clen == 0 || clen >= n) {
+			/* store it */
+			if ((unsigned long)(oend - op - 4) < n) {
+				free(table);
+				return 0;
+			}
+			put32(op, n | 0x80000000);
+			memcpy(op + 4, in, n);
+			clen = n;
+		} else {
+			put32(op, clen);
+		}
+		op += 4 + clen;
+	}
+	free(table);
+
+	if (oend - op < 4)
+		return 0;
+	put32(op, 0);           /* end mark */
+	return op + 4 - out;
+}
@@ -0,0 +1,212 @@
+/*
+ * Parallel gzip compressor for dropin and ROM images
+ *
+ * Splits the input into BLOCK-sized pieces and deflates them on
+ * several threads at once, in the manner of pigz.  Each piece is
+ * primed with the 32K of input that precedes it, so matches may still
+ * reach back across a piece boundary, and each one but the last ends
+ * with a sync flush, which pads it to a byte boundary without ending
+ * the deflate stream.  The pieces then simply concatenate into one
+ * ordinary gzip member that the firmware's inflater (inflate.c) reads
+ * like any other.
+ *
+ * The output depends only on the input, not on the number of threads.
+ * An input of one block or less comes out exactly as compress() would
+ * have made it, so small dropins are byte-for-byte unchanged.  Larger
+ * ones grow by a few bytes per block.
+ *
+ * Hosts without POSIX threads (WIN32) compress the blocks one after
+ * another, which gives the same output.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#ifndef WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#include "zlib.h"
+
+extern void crc32_fast_init(void);
+extern unsigned long crc32_fast(unsigned long, const unsigned char *,
+				unsigned long);
+
+#define	BLOCK		(128 * 1024)
+#define	DICT		(32 * 1024)
+#define	MAX_THREADS	64
+
+struct piece {
+	const unsigned char *in;
+	unsigned long len;
+	int last;
+	unsigned char *out;
+	unsigned long outlen;
+	unsigned long crc;
+	int err;
+};
+
+struct work {
+	struct piece *pieces;
+	int npieces;
+	int next;                       /* next piece to compress */
+#ifndef WIN32
+	pthread_mutex_t lock;
+#endif
+};
+
+static void
+compress_piece(struct piece *p, const unsigned char *start)
+{
+	z_stream z;
+	unsigned long max;
+	int ret;
+
+	p->crc = crc32_fast(0L, p->in, p->len);
+
+	memset(&z, 0, sizeof(z));
+	if (deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS,
+			 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		p->err = 1;
+		return;
+	}
+	if (p->in != start) {
+		/* the preceding input, so matches can reach into it */
+		if (deflateSetDictionary(&z, p->in - DICT, DICT) != Z_OK) {
+			deflateEnd(&z);
+			p->err = 1;
+			return;
+		}
+	}
+	/* room for the worst case plus the empty stored block of a flush */
+	max = deflateBound(&z, p->len) + 16;
+	if ((p->out = malloc(max)) == NULL) {
+		deflateEnd(&z);
+		p->err = 1;
+		return;
+	}
+	z.next_in = (Bytef *)p->in;
+	z.avail_in = p->len;
+	z.next_out = p->out;
+	z.avail_out = max;
+	ret = deflate(&z, p->last ? Z_FINISH : Z_SYNC_FLUSH);
+	if (p->last ? ret != Z_STREAM_END : (ret != Z_OK || z.avail_out == 0))
+		p->err = 1;
+	p->outlen = max - z.avail_out;
+	deflateEnd(&z);
+}
+
+static void *
+worker(void *arg)
+{
+	struct work *w = arg;
+	int i;
+
+	for (;;) {
+#ifndef WIN32
+		pthread_mutex_lock(&w->lock);
+#endif
+		i = w->next++;
+#ifndef WIN32
+		pthread_mutex_unlock(&w->lock);
+#endif
+		if (i >= w->npieces)
+			return (NULL);
+		compress_piece(&w->pieces[i], w->pieces[0].in);
+	}
+}
+
+static void
+run_workers(struct work *w, int nthreads)
+{
+#ifndef WIN32
+	pthread_t tid[MAX_THREADS];
+	int i, n;
+
+	if (nthreads <= 0)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nthreads > w->npieces)
+		nthreads = w->npieces;
+	if (nthreads > MAX_THREADS)
+		nthreads = MAX_THREADS;
+
+	pthread_mutex_init(&w->lock, NULL);
+	/* this thread is one of the workers */
+	for (n = 0; n < nthreads - 1; n++)
+		if (pthread_create(&tid[n], NULL, worker, w) != 0)
+			break;
+	worker(w);
+	for (i = 0; i < n; i++)
+		pthread_join(tid[i], NULL);
+	pthread_mutex_destroy(&w->lock);
+#else
+	worker(w);
+#endif
+}
+
+static void
+put_le32(unsigned char *p, unsigned long v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+/*
+ * Compress inlen bytes at in into a gzip member at out, using up to
+ * nthreads threads, or one per processor if nthreads is 0 or less.
+ * Returns the member length, or 0 if it does not fit in outmax bytes
+ * or memory runs out.
+ */
+unsigned long
+pdeflate(const unsigned char *in, unsigned long inlen,
+	 unsigned char *out, unsigned long outmax, int nthreads)
+{
+	static const unsigned char gzip_hdr[] = {
+		0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03
+	};
+	struct work w;
+	struct piece *p;
+	unsigned long pos, len, crc;
+	int i, bad;
+
+	w.npieces = inlen ? (inlen + BLOCK - 1) / BLOCK : 1;
+	w.pieces = calloc(w.npieces, sizeof(struct piece));
+	if (w.pieces == NULL)
+		return (0);
+	w.next = 0;
+	for (i = 0, pos = 0; i < w.npieces; i++, pos += BLOCK) {
+		p = &w.pieces[i];
+		p->in = in + pos;
+		p->len = inlen - pos < BLOCK ? inlen - pos : BLOCK;
+		p->last = (i == w.npieces - 1);
+	}
+
+	crc32_fast_init();
+	run_workers(&w, nthreads);
+
+	len = sizeof(gzip_hdr);
+	crc = 0;
+	bad = outmax < sizeof(gzip_hdr) + 8;
+	if (!bad)
+		memcpy(out, gzip_hdr, sizeof(gzip_hdr));
+	for (i = 0; i < w.npieces; i++) {
+		p = &w.pieces[i];
+		if (p->err || len + p->outlen + 8 > outmax)
+			bad = 1;
+		if (!bad) {
+			memcpy(out + len, p->out, p->outlen);
+			len += p->outlen;
+			crc = crc32_combine(crc, p->crc, p->len);
+		}
+		free(p->out);
+	}
+	free(w.pieces);
+	if (bad)
+		return (0);
+
+	/* The CRC and input length are little-endian */
+	put_le32(out + len, crc);
+	put_le32(out + len + 4, inlen);
+	return (len + 8);
+}
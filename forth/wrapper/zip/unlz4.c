@@ -0,0 +1,238 @@
+/*
+ * ROMable LZ4 decoder
+ *
+ * This is the LZ4 counterpart of the inflate module in inflate.c, for
+ * dropins that are compressed with forth/wrapper/zip/lz4comp.c
+ * instead of deflate.  LZ4 is a byte-oriented LZ77 format with no
+ * entropy coding, so it decodes several times faster than deflate,
+ * at the cost of a somewhat larger image.
+ *
+ * Like inflate.c, this is pure text: there is no data or bss, it is
+ * position-independent, and the entry point comes first so that it
+ * winds up at offset 0 of the module.  The calling convention is the
+ * same as inflate(), so the same startup code and Forth glue can call
+ * either one.  The workspace argument is not used.
+ *
+ * The input is an LZ4 frame (the format of the "lz4" command):
+ *	Magic:       0x04,0x22,0x4d,0x18
+ *	Descriptor:  FLG, BD, optional content size and dictionary id,
+ *	             and a header checksum, which is not checked here.
+ *	             lz4comp.c always records the content size, which
+ *	             lets most copies run a word at a time without tails.
+ *	Blocks:      4-byte little-endian size, then the block data.
+ *	             If the size's top bit is set the block is stored.
+ *	             A block checksum follows if FLG says so.
+ *	End mark:    4 zero bytes, then an optional content checksum
+ * With nohdr nonzero the input starts directly at the first block.
+ *
+ * Returns the expanded length, or -1 for bad data.
+ */
+
+#define u_long  unsigned long
+#define u_char  unsigned char
+#define NULL    (void *)0
+
+#define	LZ4_MAGIC	0x184d2204
+
+#define	FLG_BLOCK_SUM	0x10
+#define	FLG_SIZE	0x08
+#define	FLG_DICT_ID	0x01
+
+#if (defined(__i386__) || defined(__x86_64__) || defined(__aarch64__)) \
+    && !defined(BI_ENDIAN) && !defined(__BIG_ENDIAN__) && !defined(__AARCH64EB__)
+#define UNALIGNED_OK
+typedef u_long __attribute__((__may_alias__, __aligned__(1))) u_word;
+#define LOADW(p)	(*(u_word *)(p))
+#define STOREW(p, v)	(*(u_word *)(p) = (v))
+#endif
+
+#define	GET_LE32(p)	((p)[0] | ((p)[1] << 8) | ((p)[2] << 16) \
+			 | ((u_long)(p)[3] << 24))
+
+static u_char *lz4_block(u_char *ip, u_char *iend, u_char *op,
+    u_char *clear, u_char *oend);
+
+int
+unlz4(void *ws, int nohdr, u_char *clear, u_char *compr)
+#ifndef __llvm__
+    __attribute__((section ("text_inflate")))
+#endif
+;
+
+int
+unlz4(void *ws, int nohdr, u_char *clear, u_char *compr)
+{
+	u_char *ip = compr;
+	u_char *op = clear;
+	u_char *oend = clear;           /* end of output, if known */
+	u_long size;
+	int flg = 0;
+
+	if (nohdr == 0) {
+		if (GET_LE32(ip) != LZ4_MAGIC)
+			return (-1);
+		flg = ip[4];
+		if ((flg & 0xc0) != 0x40)       /* version 01 */
+			return (-1);
+		ip += 6;                        /* magic, FLG, BD */
+		if (flg & FLG_SIZE) {
+			if (GET_LE32(ip + 4) == 0)
+				oend = clear + GET_LE32(ip);
+			ip += 8;
+		}
+		if (flg & FLG_DICT_ID)
+			ip += 4;
+		ip += 1;                        /* header checksum */
+	}
+
+	while ((size = GET_LE32(ip)) != 0) {
+		ip += 4;
+		if (size & 0x80000000) {
+			/* stored block */
+			size &= 0x7fffffff;
+			while (size--)
+				*op++ = *ip++;
+		} else {
+			op = lz4_block(ip, ip + size, op, clear, oend);
+			if (op == NULL)
+				return (-1);
+			ip += size;
+		}
+		if (flg & FLG_BLOCK_SUM)
+			ip += 4;
+	}
+	if (oend != clear && op != oend)
+		return (-1);
+	return ((int)(op - clear));
+}
+
+/*
+ * Copy len bytes forward from "from" to op, where the regions may
+ * overlap as in an LZ77 match.  Words are used only where each load
+ * sees bytes that have already been stored, and nothing is written
+ * past op + len, since the output buffer is exactly the expanded size.
+ * Most literal runs and matches are short, so a run of 8 or more bytes
+ * ends with one word that overlaps the previous one rather than with a
+ * byte loop.
+ */
+static inline u_char *
+copy_fwd(u_char *op, u_char *from, u_long len)
+{
+#ifdef UNALIGNED_OK
+	u_char *end = op + len;
+
+	if ((u_long)(op - from) >= sizeof(u_long) && len >= sizeof(u_long)) {
+		do {
+			STOREW(op, LOADW(from));
+			op += sizeof(u_long);
+			from += sizeof(u_long);
+			len -= sizeof(u_long);
+		} while (len >= sizeof(u_long));
+		if (len)
+			STOREW(end - sizeof(u_long),
+			    LOADW(from + len - sizeof(u_long)));
+		return (end);
+	}
+	if (op - from == 1 && len >= sizeof(u_long)) {
+		u_long pat = from[0] * (~0UL / 0xff);
+
+		do {
+			STOREW(op, pat);
+			op += sizeof(u_long);
+			len -= sizeof(u_long);
+		} while (len >= sizeof(u_long));
+		if (len)
+			STOREW(end - sizeof(u_long), pat);
+		return (end);
+	}
+#endif
+	while (len--)
+		*op++ = *from++;
+	return (op);
+}
+
+/*
+ * When the output end is known, copies that are far enough from it
+ * and from the end of the input may overshoot by up to two words, so
+ * the usual short copy is two word moves with no loop and no tail.
+ */
+#ifdef UNALIGNED_OK
+#define	WILD		(2 * sizeof(u_long))
+#define	WILD_OK(op, oend, len)	((long)((oend) - (op)) >= (long)((len) + WILD))
+
+static inline u_char *
+wild_copy(u_char *op, u_char *from, u_long len)
+{
+	u_char *end = op + len;
+
+	STOREW(op, LOADW(from));
+	STOREW(op + sizeof(u_long), LOADW(from + sizeof(u_long)));
+	if (len > WILD) {
+		op += WILD;
+		from += WILD;
+		do {
+			STOREW(op, LOADW(from));
+			op += sizeof(u_long);
+			from += sizeof(u_long);
+		} while (op < end);
+	}
+	return (end);
+}
+#endif
+
+/*
+ * Decode one compressed block.  Each sequence is a token whose high
+ * nibble is the literal count and low nibble the match length minus 4,
+ * with 15 meaning that more length bytes follow, then the literals,
+ * then a 2-byte little-endian match offset.  The last sequence has
+ * literals only.
+ */
+static u_char *
+lz4_block(u_char *ip, u_char *iend, u_char *op, u_char *clear, u_char *oend)
+{
+	u_long token, len, off, c;
+
+	while (ip < iend) {
+		token = *ip++;
+
+		len = token >> 4;
+		if (len == 15) {
+			do {
+				c = *ip++;
+				len += c;
+			} while (c == 255);
+		}
+		if (len > (u_long)(iend - ip))
+			return (NULL);
+#ifdef UNALIGNED_OK
+		if (WILD_OK(op, oend, len) && WILD_OK(ip, iend, len))
+			op = wild_copy(op, ip, len);
+		else
+#endif
+			op = copy_fwd(op, ip, len);
+		ip += len;
+		if (ip >= iend)
+			break;
+
+		off = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (off == 0 || off > (u_long)(op - clear))
+			return (NULL);
+
+		len = token & 15;
+		if (len == 15) {
+			do {
+				c = *ip++;
+				len += c;
+			} while (c == 255);
+		}
+		len += 4;
+#ifdef UNALIGNED_OK
+		if (off >= sizeof(u_long) && WILD_OK(op, oend, len))
+			op = wild_copy(op, op - off, len);
+		else
+#endif
+			op = copy_fwd(op, op - off, len);
+	}
+	return (op);
+}